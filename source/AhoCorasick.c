@@ -0,0 +1,365 @@
+/* ========================================================================= *
+ * AhoCorasick
+ *
+ * Aho-Corasick automaton over the keys of a set, stored as the sorted edges
+ * of its trie and the failure links of its states (see AhoCorasick.h).
+ * ========================================================================= */
+
+#include "AhoCorasick.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROOT 0
+#define NONE -1
+#define INIT_CAPACITY 1024
+#define NB_CODES 256
+
+/* Structures */
+
+/*
+ * The states are those of the trie of the keys, numbered in breadth-first
+ * order. The edges of all the states are kept in two arrays, those of a state
+ * being consecutive and sorted by code, so that a state costs a few bytes
+ * whatever the number of characters. A character that has no edge from a
+ * state is read again from its failure link (its longest proper suffix that
+ * is a state), down to the root, whose transitions are all kept in a dense
+ * row. Each failure followed shortens the string of the state, so a scan
+ * still takes linear time. The characters are first mapped to codes: code 0
+ * stands for all the characters used by no key, which always lead back to
+ * the root.
+ */
+struct AhoCorasick_t
+{
+    uint32_t *first;     // the edges of a state are first[state] to first[state + 1] - 1
+    uint8_t *labels;     // code of each edge
+    int32_t *targets;    // target of each edge
+    int32_t *fail;       // failure link of a state
+    uint32_t *depth;     // length of the string read from the root to a state
+    int32_t *output;     // longest key that is a suffix of the string of a state, NONE if none
+    int32_t *link;       // output of the failure link of a state: the next shorter key
+    size_t nbStates;
+    size_t nbCodes;      // number of distinct characters of the keys, plus code 0
+    uint8_t codes[NB_CODES];     // code of each character
+    int32_t rootNext[NB_CODES];  // transition of the root for each code
+};
+
+/*
+ * The trie is first built with one list of children per node, in the order
+ * the keys come from the set, and then laid out breadth first.
+ */
+typedef struct Trie_t
+{
+    int32_t *child;      // first child of a node, NONE if none
+    int32_t *sibling;    // next child of the parent of a node, NONE if none
+    uint8_t *label;      // code of the edge leading to a node
+    uint32_t *depth;     // length of the string of a node
+    bool *key;           // a key ends at a node
+    size_t nbNodes;
+    size_t capacity;     // number of nodes allocated
+    const uint8_t *codes; // those of the automaton
+} Trie;
+
+/* Prototypes */
+
+static bool addCodes(const char *key, size_t length, void *ac);
+static int32_t addNode(Trie *trie, int32_t parent, uint8_t label, uint32_t depth);
+static bool addKey(const char *key, size_t length, void *trie);
+static void freeTrie(Trie *trie);
+static int32_t step(const AhoCorasick *ac, int32_t state, uint8_t code);
+static bool layOut(AhoCorasick *ac, const Trie *trie);
+
+/* static functions */
+
+/**
+ * @brief SetVisitor giving a code to each new character of a key
+ *
+ * @param key      A key of the set
+ * @param length   The length of key
+ * @param ac       A pointer to the automaton being built
+ * @return bool    Always true
+ */
+static bool addCodes(const char *key, size_t length, void *ac)
+{
+    AhoCorasick *automaton = ac;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = (unsigned char)key[i];
+        if (automaton->codes[c] == 0)
+            automaton->codes[c] = (uint8_t)automaton->nbCodes++;
+    }
+    return true;
+}
+
+/**
+ * @brief Add a node without children to the trie
+ *
+ * @param trie     A pointer to the trie being built
+ * @param parent   The parent of the node, NONE for the root
+ * @param label    The code of the edge from parent to the node
+ * @param depth    The length of the string of the node
+ * @return int32_t The new node, or NONE in case of allocation error
+ */
+static int32_t addNode(Trie *trie, int32_t parent, uint8_t label, uint32_t depth)
+{
+    if (trie->nbNodes == trie->capacity)
+    {
+        if (trie->capacity >= INT32_MAX / 2)
+            return NONE;
+        size_t capacity = trie->capacity * 2;
+
+        int32_t *child = realloc(trie->child, capacity * sizeof(int32_t));
+        if (!child)
+            return NONE;
+        trie->child = child;
+        int32_t *sibling = realloc(trie->sibling, capacity * sizeof(int32_t));
+        if (!sibling)
+            return NONE;
+        trie->sibling = sibling;
+        uint8_t *labels = realloc(trie->label, capacity);
+        if (!labels)
+            return NONE;
+        trie->label = labels;
+        uint32_t *depths = realloc(trie->depth, capacity * sizeof(uint32_t));
+        if (!depths)
+            return NONE;
+        trie->depth = depths;
+        bool *keys = realloc(trie->key, capacity * sizeof(bool));
+        if (!keys)
+            return NONE;
+        trie->key = keys;
+        trie->capacity = capacity;
+    }
+
+    int32_t node = (int32_t)trie->nbNodes++;
+    trie->child[node] = NONE;
+    trie->sibling[node] = parent == NONE ? NONE : trie->child[parent];
+    trie->label[node] = label;
+    trie->depth[node] = depth;
+    trie->key[node] = false;
+    if (parent != NONE)
+        trie->child[parent] = node;
+    return node;
+}
+
+/**
+ * @brief SetVisitor adding a key to the trie
+ *
+ * @param key      A key of the set
+ * @param length   The length of key
+ * @param trie     A pointer to the trie being built
+ * @return bool    false in case of allocation error
+ */
+static bool addKey(const char *key, size_t length, void *trie)
+{
+    Trie *t = trie;
+    if (length == 0 || length > UINT32_MAX)
+        return length == 0;
+
+    int32_t node = ROOT;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint8_t code = t->codes[(unsigned char)key[i]];
+        int32_t next = t->child[node];
+        while (next != NONE && t->label[next] != code)
+            next = t->sibling[next];
+        if (next == NONE)
+        {
+            next = addNode(t, node, code, (uint32_t)(i + 1));
+            if (next == NONE)
+                return false;
+        }
+        node = next;
+    }
+    t->key[node] = true;
+    return true;
+}
+
+/**
+ * @brief Free the arrays of a trie
+ *
+ * @param trie     A pointer to a trie
+ */
+static void freeTrie(Trie *trie)
+{
+    free(trie->child);
+    free(trie->sibling);
+    free(trie->label);
+    free(trie->depth);
+    free(trie->key);
+}
+
+/**
+ * @brief Follow the transition of a state reading a code, through the failure
+ *        links of the state until one has an edge for it.
+ *
+ * @param ac       A pointer to an automaton, whose edges from state and from
+ *                 the states of its failure links are laid out
+ * @param state    A state
+ * @param code     The code of a character
+ * @return int32_t The next state
+ */
+static int32_t step(const AhoCorasick *ac, int32_t state, uint8_t code)
+{
+    if (code == 0)
+        return ROOT;
+
+    while (state != ROOT)
+    {
+        uint32_t end = ac->first[state + 1];
+        for (uint32_t e = ac->first[state]; e < end && ac->labels[e] <= code; e++)
+        {
+            if (ac->labels[e] == code)
+                return ac->targets[e];
+        }
+        state = ac->fail[state];
+    }
+    return ac->rootNext[code];
+}
+
+/**
+ * @brief Number the nodes of the trie in breadth-first order and write the
+ *        edges of each state, sorted, with its failure link and outputs. The
+ *        failure link of a state is shallower than its parent, so the edges
+ *        it needs are already written when the state is numbered.
+ *
+ * @param ac       A pointer to the automaton being built
+ * @param trie     The trie of the keys
+ * @return bool    false in case of allocation error
+ */
+static bool layOut(AhoCorasick *ac, const Trie *trie)
+{
+    size_t nbStates = trie->nbNodes;
+    int32_t *order = malloc(nbStates * sizeof(int32_t)); // the nodes by state
+    ac->first = malloc((nbStates + 1) * sizeof(uint32_t));
+    ac->labels = malloc(nbStates); // every node but the root has an edge
+    ac->targets = malloc(nbStates * sizeof(int32_t));
+    ac->fail = malloc(nbStates * sizeof(int32_t));
+    ac->depth = malloc(nbStates * sizeof(uint32_t));
+    ac->output = malloc(nbStates * sizeof(int32_t));
+    ac->link = malloc(nbStates * sizeof(int32_t));
+    ac->nbStates = nbStates;
+    if (!order || !ac->first || !ac->labels || !ac->targets || !ac->fail || !ac->depth || !ac->output ||
+        !ac->link)
+    {
+        free(order);
+        return false;
+    }
+
+    order[ROOT] = ROOT;
+    ac->fail[ROOT] = ROOT;
+    ac->depth[ROOT] = 0;
+    ac->output[ROOT] = NONE;
+    ac->link[ROOT] = NONE;
+    for (size_t code = 0; code < NB_CODES; code++)
+        ac->rootNext[code] = ROOT;
+
+    uint32_t nbEdges = 0;
+    int32_t tail = 1;
+    for (int32_t state = 0; state < tail; state++)
+    {
+        ac->first[state] = nbEdges;
+
+        // the children of the node, sorted by code
+        int32_t children[NB_CODES];
+        int nbChildren = 0;
+        for (int32_t child = trie->child[order[state]]; child != NONE; child = trie->sibling[child])
+        {
+            int i = nbChildren++;
+            for (; i > 0 && trie->label[children[i - 1]] > trie->label[child]; i--)
+                children[i] = children[i - 1];
+            children[i] = child;
+        }
+
+        for (int i = 0; i < nbChildren; i++)
+        {
+            int32_t child = tail++;
+            uint8_t code = trie->label[children[i]];
+            order[child] = children[i];
+            ac->labels[nbEdges] = code;
+            ac->targets[nbEdges++] = child;
+
+            ac->fail[child] = state == ROOT ? ROOT : step(ac, ac->fail[state], code);
+            ac->depth[child] = trie->depth[children[i]];
+            ac->link[child] = ac->output[ac->fail[child]];
+            ac->output[child] = trie->key[children[i]] ? child : ac->link[child];
+            if (state == ROOT)
+                ac->rootNext[code] = child;
+        }
+    }
+    ac->first[nbStates] = nbEdges;
+
+    free(order);
+    return true;
+}
+
+/* header functions */
+
+AhoCorasick *acCreate(const Set *set)
+{
+    AhoCorasick *ac = calloc(1, sizeof(AhoCorasick));
+    if (!ac)
+        return NULL;
+
+    // the codes are known before the first key is added: a character
+    // missed by a failed visit would be taken for one used by no key
+    ac->nbCodes = 1;
+    if (!setVisitAllKeys(set, addCodes, ac))
+    {
+        free(ac);
+        return NULL;
+    }
+
+    Trie trie = {NULL, NULL, NULL, NULL, NULL, 0, INIT_CAPACITY, ac->codes};
+    trie.child = malloc(trie.capacity * sizeof(int32_t));
+    trie.sibling = malloc(trie.capacity * sizeof(int32_t));
+    trie.label = malloc(trie.capacity);
+    trie.depth = malloc(trie.capacity * sizeof(uint32_t));
+    trie.key = malloc(trie.capacity * sizeof(bool));
+    bool ok = trie.child && trie.sibling && trie.label && trie.depth && trie.key &&
+              addNode(&trie, NONE, 0, 0) == ROOT && setVisitAllKeys(set, addKey, &trie) && layOut(ac, &trie);
+
+    freeTrie(&trie);
+    if (!ok)
+    {
+        acFree(ac);
+        return NULL;
+    }
+    return ac;
+}
+
+void acFree(AhoCorasick *ac)
+{
+    free(ac->first);
+    free(ac->labels);
+    free(ac->targets);
+    free(ac->fail);
+    free(ac->depth);
+    free(ac->output);
+    free(ac->link);
+    free(ac);
+}
+
+size_t acMemoryUsage(const AhoCorasick *ac)
+{
+    // the edge arrays have room for one edge per state: one leads to each but the root
+    return sizeof(AhoCorasick) + (ac->nbStates + 1) * sizeof(uint32_t) +
+           ac->nbStates * (sizeof(uint8_t) + 4 * sizeof(int32_t) + sizeof(uint32_t));
+}
+
+bool acScan(const AhoCorasick *ac, const char *text, SetVisitor visit, void *context)
+{
+    int32_t state = ROOT;
+    for (size_t i = 0; text[i] != '\0'; i++)
+    {
+        state = step(ac, state, ac->codes[(unsigned char)text[i]]);
+
+        for (int32_t key = ac->output[state]; key != NONE; key = ac->link[key])
+        {
+            size_t length = ac->depth[key];
+            if (!visit(text + i + 1 - length, length, context))
+                return false;
+        }
+    }
+    return true;
+}
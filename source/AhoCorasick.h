@@ -0,0 +1,57 @@
+#ifndef _AHOCORASICK_H_
+#define _AHOCORASICK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "Set.h"
+
+/*
+ * An Aho-Corasick automaton built from the keys of a set. It reads a text once,
+ * one character at a time, and reports every key ending at each position, so
+ * that all the occurrences of all the keys are found without restarting the
+ * search at every start position of the text.
+ */
+
+/** AhoCorasick (opaque) structure */
+typedef struct AhoCorasick_t AhoCorasick;
+
+/**
+ * @brief Build the automaton of the keys of a set. The empty key, if any, is
+ *        ignored. The set is not used anymore once the automaton is built.
+ *        The returned automaton needs to be freed with acFree.
+ *
+ * @param set          A pointer to a set
+ * @return AhoCorasick* The automaton, or NULL in case of allocation error
+ */
+AhoCorasick *acCreate(const Set *set);
+
+/**
+ * @brief Free the automaton
+ *
+ * @param ac           A pointer to an automaton
+ */
+void acFree(AhoCorasick *ac);
+
+/**
+ * @brief Return the number of bytes used by the automaton.
+ *
+ * @param ac           A pointer to an automaton
+ * @return size_t      The number of bytes
+ */
+size_t acMemoryUsage(const AhoCorasick *ac);
+
+/**
+ * @brief Call visit on every occurrence of a key in a text, in the order of the
+ *        position where it ends (the longest key first for a same position).
+ *        The key given to visit points into the text.
+ *
+ * @param ac           A pointer to an automaton
+ * @param text         A valid string
+ * @param visit        The function called for each occurrence
+ * @param context      Passed as is to visit
+ * @return bool        false if the scan was stopped by visit, true otherwise
+ */
+bool acScan(const AhoCorasick *ac, const char *text, SetVisitor visit, void *context);
+
+#endif // !_AHOCORASICK_H_
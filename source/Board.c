@@ -1,10 +1,17 @@
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+#include "AhoCorasick.h"
 #include "Board.h"
 #include "List.h"
+#include "PairScan.h"
+#include "Parallel.h"
 #include "Set.h"
 
 const char alphabet[26] = "abcdefghijklmnopqrstuvwxyz";
@@ -17,19 +24,103 @@ const float probaLetters[26] = {7.8, 2.0, 4.0, 3.8, 11.0, 1.4, 3.0, 2.3, 8.6,
 
 #define MIN(a, b) a < b ? a : b
 
+#define BORDER 1 // width of the sentinel ring around the grid
+#define NB_DIRECTIONS 8
+#define SCANS_BEFORE_INDEX 64 // words searched by scanning the grid before building the index
+#define LEXICON_CHUNK 1024    // words taken at once by a thread of boardGetAllWordsFromLexicon
+
+// row and column increments of the directions, in the order they are tried
+static const int directions[NB_DIRECTIONS][2] = {
+    {1, 0},   // down
+    {1, 1},   // down - right
+    {1, -1},  // down - left
+    {-1, 0},  // up
+    {-1, 1},  // up - right
+    {-1, -1}, // up - left
+    {0, 1},   // right
+    {0, -1},  // left
+};
+
+/*
+ * The grid is stored row-major in a single buffer of width*width cells, with
+ * a ring of BORDER '\0' cells around the actual board. No word contains a
+ * '\0', so every walk along a direction stops on the sentinel at the latest
+ * and never needs an explicit bounds check. flag uses the same layout.
+ *
+ * boardContainsWord first scans the grid for the starts whose first two
+ * letters match, 16 or 32 cells at a time (see scanContainsWord). Once enough
+ * words were searched to pay for it, it builds an index of the cells holding
+ * each letter, and of the cells followed by each letter in each direction,
+ * stored as arrays of cells sorted by key (see buildIndex), and only tries the
+ * starts it gives. If the index cannot be built, the grid is still scanned.
+ *
+ * With boardUseBitboards, the grid is also kept as 26 bitplanes, one per
+ * letter, bit p of a plane being set if cell p holds the letter (the sentinel
+ * cells are in no plane). The starts of a word in a direction are then the
+ * bits set in the AND of the planes of its letters, the plane of letter i
+ * being shifted by i steps: 64 starts are tried at once (see bitboardContainsWord).
+ */
 struct Board_t
 {
     size_t size;
-    char **grid;
-    bool **flag;
+    size_t width;
+    char *grid;
+    bool *flag;
+    ptrdiff_t steps[NB_DIRECTIONS]; // see directionStep
+
+    // letters of the grid, for boardMayContainWord
+    size_t letterCount[26];   // number of cells holding the letter 'a' + i
+    uint32_t presence;        // the letters of the grid, as in boardLetterMask
+    uint32_t scarce;          // the letters held by less than size cells
+
+    // the only cells set in flag: len cells from start, following step
+    size_t highlightStart;
+    ptrdiff_t highlightStep;
+    size_t highlightLength;
+
+    size_t nbScans;         // words searched by scanContainsWord
+    bool indexBuilt;        // buildIndex was called (the arrays are NULL if it failed)
+    uint8_t codes[256];     // code of each letter of the board, from 1, 0 for the others
+    size_t nbCodes;         // number of letters of the board, plus 1
+    size_t *letterStart;    // cells of letter a: letterCells[letterStart[a] .. letterStart[a + 1][
+    uint32_t *letterCells;
+    size_t *pairStart;      // cells of letter a followed by b in direction d: the same way,
+    uint32_t *pairCells;    // with key pairKey(board, a, b, d)
+
+    uint64_t *planes;       // NULL, or the plane of letter 'a' + i at planePointer(board, i)
+    size_t nbWords;         // number of 64-bit words of a plane, without its padding
 };
 
+typedef struct LexiconSearch_t // shared by the threads of boardGetAllWordsFromLexicon
+{
+    const Board *board;
+    const char *const *words;
+    const uint32_t *masks;
+    size_t nbWords;
+    pthread_mutex_t lock;
+    size_t next;            // the first word of the next chunk, protected by lock
+    unsigned char *found;   // found[i] is 1 if words[i] is on the board, 2 if pruned
+} LexiconSearch;
+
 /* Prototypes */
 
 static void terminate(char *m);
 static char getRandomLetter(void);
+static size_t cellIndex(const Board *board, size_t r, size_t c);
+static ptrdiff_t directionStep(const Board *board, int incr, int incc);
 static void boardInitFlag(Board *board);
-static bool searchDirection(Board *board, const char *word, int len, int r, int c, int incr, int incc);
+static void clearHighlight(Board *board);
+static void highlight(Board *board, size_t start, ptrdiff_t step, size_t len);
+static bool searchDirection(const Board *board, const char *word, int len, size_t start, ptrdiff_t step);
+static size_t pairKey(const Board *board, size_t a, size_t b, int d);
+static void buildIndex(Board *board);
+static void countLetters(Board *board);
+static bool scanContainsWord(const Board *board, const char *word, int len, size_t *start, int *d);
+static const uint64_t *planePointer(const Board *board, int letter);
+static bool bitboardContainsWord(const Board *board, const char *word, int len, size_t *start, int *d);
+static bool indexContainsWord(const Board *board, const char *word, int len, size_t *start, int *d);
+static bool findWord(const Board *board, const char *word, int len, size_t *start, int *d);
+static void *lexiconWorker(void *context);
 
 /* static functions */
 
@@ -65,6 +156,33 @@ static char getRandomLetter(void)
     return alphabet[i];
 }
 
+/**
+ * @brief Return the index in grid (and flag) of the cell at position (r,c)
+ *
+ * @param board       a pointer to a board
+ * @param r           the row, in [0, size[
+ * @param c           the column, in [0, size[
+ * @return size_t
+ */
+static size_t cellIndex(const Board *board, size_t r, size_t c)
+{
+    return (r + BORDER) * board->width + c + BORDER;
+}
+
+/**
+ * @brief Return the offset to add to a cell index to move by incr rows
+ *        and incc columns
+ *
+ * @param board       a pointer to a board
+ * @param incr        the row increment
+ * @param incc        the column increment
+ * @return ptrdiff_t
+ */
+static ptrdiff_t directionStep(const Board *board, int incr, int incc)
+{
+    return (ptrdiff_t)incr * (ptrdiff_t)board->width + incc;
+}
+
 /**
  * @brief Initialize the flags to false.
  *
@@ -72,53 +190,435 @@ static char getRandomLetter(void)
  */
 static void boardInitFlag(Board *board)
 {
-    for (size_t r = 0; r < board->size; r++)
-        for (size_t c = 0; c < board->size; c++)
-            board->flag[r][c] = false;
+    memset(board->flag, false, board->width * board->width * sizeof(bool));
+    board->highlightStart = 0;
+    board->highlightStep = 0;
+    board->highlightLength = 0;
+}
+
+/**
+ * @brief Reset to false the flags set by the last word found, the only ones set.
+ *
+ * @param board
+ */
+static void clearHighlight(Board *board)
+{
+    bool *flag = board->flag + board->highlightStart;
+    for (size_t i = 0; i < board->highlightLength; i++)
+    {
+        *flag = false;
+        flag += board->highlightStep;
+    }
+    board->highlightLength = 0;
 }
 
 /**
- * @brief return true if the word is found at position (r,c) in the direction
- *        obtained by incrementing row and column by incr and incc respetively
+ * @brief Highlight a word found: the flags of the last word highlighted are
+ *        reset, and those of the len cells from start following step are set.
+ *
+ * @param board       a pointer to a board
+ * @param start       the index of the first cell
+ * @param step        the direction step (see directionStep)
+ * @param len         the length of the word
+ */
+static void highlight(Board *board, size_t start, ptrdiff_t step, size_t len)
+{
+    clearHighlight(board);
+
+    bool *flag = board->flag + start;
+    for (size_t i = 0; i < len; i++)
+    {
+        *flag = true;
+        flag += step;
+    }
+    board->highlightStart = start;
+    board->highlightStep = step;
+    board->highlightLength = len;
+}
+
+/**
+ * @brief return true if the word is found at cell index start in the direction
+ *        obtained by adding step to the cell index. The sentinel ring stops the
+ *        walk at the border of the board.
  *
  * @param board       a pointer to a board
  * @param word        the word to be found
  * @param len         the length of the word
- * @param r           the starting row
- * @param c           the starting column
- * @param incr        the row increment
- * @param incc        the column increment
+ * @param start       the index of the starting cell
+ * @param step        the direction step (see directionStep)
  * @return true       if the word is found
  * @return false      otherwise
  */
-static bool searchDirection(Board *board, const char *word, int len, int r, int c, int incr, int incc)
+static bool searchDirection(const Board *board, const char *word, int len, size_t start, ptrdiff_t step)
 {
+    const char *cell = board->grid + start;
     int i = 0;
-    int sr = r;
-    int sc = c;
-    while (i < len && board->grid[sr][sc] == word[i])
+    while (i < len && *cell == word[i])
     {
         i++;
-        sr += incr;
-        sc += incc;
+        cell += step;
+    }
+
+    return i == len;
+}
+
+/**
+ * @brief Return the key of the pair index for a letter of code a followed by
+ *        a letter of code b in the direction d
+ *
+ * @param board       a pointer to a board
+ * @param a           the code of the first letter
+ * @param b           the code of the second letter
+ * @param d           the index of the direction in board->steps
+ * @return size_t
+ */
+static size_t pairKey(const Board *board, size_t a, size_t b, int d)
+{
+    return (a * board->nbCodes + b) * NB_DIRECTIONS + (size_t)d;
+}
+
+/**
+ * @brief Build the letter and pair indexes of the board, by counting sort: the
+ *        cells are counted per key, the counts give the start of each key,
+ *        then the cells are stored in increasing order. On allocation error,
+ *        the arrays are left NULL.
+ *
+ * @param board       a pointer to a board
+ */
+static void buildIndex(Board *board)
+{
+    size_t n = board->size;
+    board->indexBuilt = true;
+    if (board->width * board->width > UINT32_MAX) // cells are stored on 32 bits
+        return;
+
+    board->nbCodes = 1;
+    for (size_t r = 0; r < n; r++)
+    {
+        for (size_t c = 0; c < n; c++)
+        {
+            unsigned char letter = (unsigned char)board->grid[cellIndex(board, r, c)];
+            if (board->codes[letter] == 0)
+                board->codes[letter] = (uint8_t)board->nbCodes++;
+        }
+    }
+
+    size_t nbPairKeys = board->nbCodes * board->nbCodes * NB_DIRECTIONS;
+    board->letterStart = calloc(board->nbCodes + 1, sizeof(size_t));
+    board->pairStart = calloc(nbPairKeys + 1, sizeof(size_t));
+    board->letterCells = malloc(n * n * sizeof(uint32_t));
+    board->pairCells = malloc(NB_DIRECTIONS * n * n * sizeof(uint32_t));
+    if (!board->letterStart || !board->pairStart || !board->letterCells || !board->pairCells)
+    {
+        free(board->letterStart);
+        free(board->pairStart);
+        free(board->letterCells);
+        free(board->pairCells);
+        board->letterStart = board->pairStart = NULL;
+        board->letterCells = board->pairCells = NULL;
+        return;
+    }
+
+    // count, shifted by one so that the prefix sums give the starts
+    for (size_t r = 0; r < n; r++)
+    {
+        for (size_t c = 0; c < n; c++)
+        {
+            size_t cell = cellIndex(board, r, c);
+            size_t a = board->codes[(unsigned char)board->grid[cell]];
+            board->letterStart[a + 1]++;
+            for (int d = 0; d < NB_DIRECTIONS; d++)
+            {
+                char next = board->grid[cell + board->steps[d]];
+                if (next != '\0')
+                    board->pairStart[pairKey(board, a, board->codes[(unsigned char)next], d) + 1]++;
+            }
+        }
+    }
+    for (size_t k = 0; k < board->nbCodes; k++)
+        board->letterStart[k + 1] += board->letterStart[k];
+    for (size_t k = 0; k < nbPairKeys; k++)
+        board->pairStart[k + 1] += board->pairStart[k];
+
+    // fill, using the start of each key as its insertion point, then restore the starts
+    for (size_t r = 0; r < n; r++)
+    {
+        for (size_t c = 0; c < n; c++)
+        {
+            size_t cell = cellIndex(board, r, c);
+            size_t a = board->codes[(unsigned char)board->grid[cell]];
+            board->letterCells[board->letterStart[a]++] = (uint32_t)cell;
+            for (int d = 0; d < NB_DIRECTIONS; d++)
+            {
+                char next = board->grid[cell + board->steps[d]];
+                if (next != '\0')
+                    board->pairCells[board->pairStart[pairKey(board, a, board->codes[(unsigned char)next], d)]++] = (uint32_t)cell;
+            }
+        }
+    }
+    memmove(board->letterStart + 1, board->letterStart, board->nbCodes * sizeof(size_t));
+    board->letterStart[0] = 0;
+    memmove(board->pairStart + 1, board->pairStart, nbPairKeys * sizeof(size_t));
+    board->pairStart[0] = 0;
+}
+
+/**
+ * @brief Count the letters of the grid, for boardMayContainWord. A word is at
+ *        most size letters long, so it can only need more copies of a letter
+ *        than the grid has if the grid holds less than size of them.
+ *
+ * @param board       a pointer to a board
+ */
+static void countLetters(Board *board)
+{
+    size_t n = board->size;
+    memset(board->letterCount, 0, sizeof(board->letterCount));
+    board->presence = 0;
+    for (size_t r = 0; r < n; r++)
+    {
+        const char *row = board->grid + cellIndex(board, r, 0);
+        for (size_t c = 0; c < n; c++)
+        {
+            if (row[c] >= 'a' && row[c] <= 'z')
+                board->letterCount[row[c] - 'a']++;
+            else
+                board->presence |= BOARD_OTHER_LETTERS;
+        }
     }
 
-    if (i == len)
+    board->scarce = 0;
+    for (int i = 0; i < 26; i++)
+    {
+        if (board->letterCount[i] > 0)
+            board->presence |= UINT32_C(1) << i;
+        if (board->letterCount[i] < n)
+            board->scarce |= UINT32_C(1) << i;
+    }
+}
+
+/**
+ * @brief Search a word without the index: the grid is scanned, direction by
+ *        direction, for the cells holding the first letter of the word followed
+ *        by its second one (see pairScanNext), and the word is only walked
+ *        from them. The starts are tried in the same order as with the index.
+ *
+ * @param board       a pointer to a board
+ * @param word        the word to be found
+ * @param len         the length of the word
+ * @param start       set to the index of the first cell of the word found
+ * @param d           set to the index of its direction in board->steps
+ * @return true       if the word is found
+ * @return false      otherwise
+ */
+static bool scanContainsWord(const Board *board, const char *word, int len, size_t *start, int *d)
+{
+    if (board->size == 0)
+        return false;
+
+    // from the first cell to the last one, the sentinel cells of the left and
+    // right borders included: they hold no letter and never match. A step
+    // from any of these cells stays in the grid, on the sentinel ring at most.
+    size_t from = cellIndex(board, 0, 0);
+    size_t to = cellIndex(board, board->size - 1, board->size - 1) + 1;
+
+    if (len == 1) // a single letter is found in the first direction
+    {
+        const char *cell = memchr(board->grid + from, word[0], to - from);
+        *start = (size_t)(cell - board->grid);
+        *d = 0;
+        return cell != NULL;
+    }
+
+    for (*d = 0; *d < NB_DIRECTIONS; (*d)++)
+    {
+        ptrdiff_t step = board->steps[*d];
+        for (*start = from;; (*start)++)
+        {
+            *start = pairScanNext(board->grid, *start, to, step, word[0], word[1]);
+            if (*start == to)
+                break;
+            if (searchDirection(board, word, len, *start, step))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Return the first word of the plane of a letter. Each plane is padded
+ *        with a zero word on both sides, so that its words -1 and nbWords can be read.
+ *
+ * @param board       a pointer to a board with bitplanes
+ * @param letter      the letter, in [0, 26[
+ * @return const uint64_t*
+ */
+static const uint64_t *planePointer(const Board *board, int letter)
+{
+    return board->planes + (size_t)letter * (board->nbWords + 2) + 1;
+}
+
+/**
+ * @brief Search a word with the bitplanes, 64 starts at a time. A word going
+ *        out of the board meets a sentinel cell, which is in no plane, so the
+ *        shifted planes need no masking. The starts are tried in the same
+ *        order as with the index: direction by direction, by increasing cell.
+ *
+ * @param board       a pointer to a board with bitplanes
+ * @param word        the word to be found, made of letters 'a'..'z'
+ * @param len         the length of the word
+ * @param start       set to the index of the first cell of the word found
+ * @param d           set to the index of its direction in board->steps
+ * @return true       if the word is found
+ * @return false      otherwise
+ */
+static bool bitboardContainsWord(const Board *board, const char *word, int len, size_t *start, int *d)
+{
+    if ((size_t)len > board->size)
+        return false;
+
+    const uint64_t *planes[len];
+    for (int i = 0; i < len; i++)
+        planes[i] = planePointer(board, word[i] - 'a');
+
+    ptrdiff_t nbWords = (ptrdiff_t)board->nbWords;
+    int nbDirections = len == 1 ? 1 : NB_DIRECTIONS; // a single letter has no direction
+
+    for (*d = 0; *d < nbDirections; (*d)++)
     {
-        i = 0;
-        while (i < len)
+        // letter i is read i * step bits further: q[i] words and r[i] bits
+        ptrdiff_t step = board->steps[*d];
+        ptrdiff_t q[len];
+        int r[len];
+        ptrdiff_t jMin = 0, jMax = nbWords - 1;
+        for (int i = 0; i < len; i++)
+        {
+            ptrdiff_t shift = i * step;
+            q[i] = shift >= 0 ? shift / 64 : -((-shift + 63) / 64); // floor division
+            r[i] = (int)(shift - q[i] * 64);
+
+            // beyond the padding, the shifted plane is 0 and so are the starts
+            if (-1 - q[i] > jMin)
+                jMin = -1 - q[i];
+            if (nbWords - 1 - q[i] < jMax)
+                jMax = nbWords - 1 - q[i];
+        }
+
+        for (ptrdiff_t j = jMin; j <= jMax; j++)
         {
-            board->flag[r][c] = true;
-            r += incr;
-            c += incc;
-            i++;
+            uint64_t starts = planes[0][j];
+            for (int i = 1; i < len && starts; i++)
+            {
+                const uint64_t *w = planes[i] + j + q[i];
+                starts &= r[i] ? (w[0] >> r[i]) | (w[1] << (64 - r[i])) : w[0];
+            }
+
+            if (starts)
+            {
+                *start = (size_t)j * 64 + (size_t)__builtin_ctzll(starts);
+                return true;
+            }
         }
+    }
+    return false;
+}
+
+/**
+ * @brief Search a word with the index: only the starts followed by the second
+ *        letter of the word in the direction tried are walked.
+ *
+ * @param board       a pointer to a board with an index
+ * @param word        the word to be found
+ * @param len         the length of the word
+ * @param start       set to the index of the first cell of the word found
+ * @param d           set to the index of its direction in board->steps
+ * @return true       if the word is found
+ * @return false      otherwise
+ */
+static bool indexContainsWord(const Board *board, const char *word, int len, size_t *start, int *d)
+{
+    size_t a = board->codes[(unsigned char)word[0]];
+    if (a == 0) // not on the board
+        return false;
+
+    if (len == 1) // a single letter is found in the first direction
+    {
+        *start = board->letterCells[board->letterStart[a]];
+        *d = 0;
         return true;
     }
 
+    size_t b = board->codes[(unsigned char)word[1]];
+    if (b == 0)
+        return false;
+
+    for (*d = 0; *d < NB_DIRECTIONS; (*d)++)
+    {
+        size_t key = pairKey(board, a, b, *d);
+        for (size_t k = board->pairStart[key]; k < board->pairStart[key + 1]; k++)
+        {
+            *start = board->pairCells[k];
+            if (searchDirection(board, word, len, *start, board->steps[*d]))
+                return true;
+        }
+    }
+
     return false;
 }
 
+/**
+ * @brief Search a word of at least one letter with the bitplanes, or else the
+ *        index, or else by scanning the grid. The board is not modified.
+ *
+ * @param board       a pointer to a board
+ * @param word        the word to be found
+ * @param len         the length of the word, at least 1
+ * @param start       set to the index of the first cell of the word found
+ * @param d           set to the index of its direction in board->steps
+ * @return true       if the word is found
+ * @return false      otherwise
+ */
+static bool findWord(const Board *board, const char *word, int len, size_t *start, int *d)
+{
+    if (board->planes && (boardLetterMask(word) & BOARD_OTHER_LETTERS) == 0)
+        return bitboardContainsWord(board, word, len, start, d);
+    if (board->letterCells)
+        return indexContainsWord(board, word, len, start, d);
+    return scanContainsWord(board, word, len, start, d);
+}
+
+/**
+ * @brief Thread of boardGetAllWordsFromLexicon: searches the words chunk by
+ *        chunk, writing the result of each word in its own cell of found.
+ *
+ * @param context     a pointer to the LexiconSearch
+ * @return void*      NULL
+ */
+static void *lexiconWorker(void *context)
+{
+    LexiconSearch *search = context;
+    BoardMatch match;
+
+    while (true)
+    {
+        pthread_mutex_lock(&search->lock);
+        size_t begin = search->next;
+        search->next = begin + LEXICON_CHUNK < search->nbWords ? begin + LEXICON_CHUNK : search->nbWords;
+        size_t end = search->next;
+        pthread_mutex_unlock(&search->lock);
+        if (begin == end)
+            return NULL;
+
+        for (size_t i = begin; i < end; i++)
+        {
+            if (!boardMayContainWord(search->board, search->words[i], search->masks[i]))
+                search->found[i] = 2;
+            else if (boardFindWord(search->board, search->words[i], &match))
+                search->found[i] = 1;
+        }
+    }
+}
+
 /* header functions */
 
 Board *boardCreate(size_t size, const char *letters)
@@ -126,57 +626,87 @@ Board *boardCreate(size_t size, const char *letters)
     if (letters != NULL && strlen(letters) < size * size)
         terminate("createBoard: letters does not have the correct size.");
 
-    Board *board = malloc(sizeof(Board));
+    size_t width = size + 2 * BORDER;
+    size_t cells = width * width;
+
+    // the structure, the grid and the flags share a single allocation
+    Board *board = malloc(sizeof(Board) + cells * (sizeof(char) + sizeof(bool)));
 
     if (board == NULL)
         terminate("createBoard: allocation failed.");
 
     board->size = size;
-    board->grid = malloc(size * sizeof(char *));
-    if (board->grid == NULL)
-        terminate("createBoard: allocation failed.");
-    board->flag = malloc(size * sizeof(bool *));
-    if (board->flag == NULL)
-        terminate("createBoard: allocation failed.");
+    board->width = width;
+    board->grid = (char *)(board + 1);
+    board->flag = (bool *)(board->grid + cells);
+
+    for (int d = 0; d < NB_DIRECTIONS; d++)
+        board->steps[d] = directionStep(board, directions[d][0], directions[d][1]);
+
+    // the index is built once SCANS_BEFORE_INDEX words were searched
+    board->nbScans = 0;
+    board->indexBuilt = false;
+    memset(board->codes, 0, sizeof(board->codes));
+    board->nbCodes = 0;
+    board->letterStart = board->pairStart = NULL;
+    board->letterCells = board->pairCells = NULL;
+    board->planes = NULL;
+    board->nbWords = 0;
+
+    memset(board->grid, '\0', cells * sizeof(char));
+    boardInitFlag(board);
 
     size_t i = 0;
 
     for (size_t r = 0; r < size; r++)
     {
-        board->grid[r] = malloc(size * sizeof(char));
-        if (board->grid[r] == NULL)
-            terminate("createBoard: allocation failed.");
-        board->flag[r] = malloc(size * sizeof(bool));
-        if (board->flag[r] == NULL)
-            terminate("createBoard: allocation failed.");
-
+        char *row = board->grid + cellIndex(board, r, 0);
         for (size_t c = 0; c < size; c++)
         {
             if (letters != NULL)
-                board->grid[r][c] = letters[i++];
+                row[c] = letters[i++];
             else
-                board->grid[r][c] = getRandomLetter();
-
-            board->flag[r][c] = false;
+                row[c] = getRandomLetter();
         }
     }
+    countLetters(board);
 
     return board;
 }
 
 void boardFree(Board *board)
 {
-    if (board == NULL)
-        return;
+    free(board->letterStart);
+    free(board->letterCells);
+    free(board->pairStart);
+    free(board->pairCells);
+    free(board->planes);
+    free(board);
+}
+
+bool boardUseBitboards(Board *board)
+{
+    if (board->planes)
+        return true;
+    if (board->presence & BOARD_OTHER_LETTERS)
+        return false;
+
+    size_t cells = board->width * board->width;
+    board->nbWords = (cells + 63) / 64;
+    board->planes = calloc(26 * (board->nbWords + 2), sizeof(uint64_t));
+    if (!board->planes)
+        return false;
 
     for (size_t r = 0; r < board->size; r++)
     {
-        free(board->grid[r]);
-        free(board->flag[r]);
+        size_t cell = cellIndex(board, r, 0);
+        for (size_t c = 0; c < board->size; c++, cell++)
+        {
+            uint64_t *plane = (uint64_t *)planePointer(board, board->grid[cell] - 'a');
+            plane[cell / 64] |= UINT64_C(1) << (cell % 64);
+        }
     }
-    free(board->grid);
-    free(board->flag);
-    free(board);
+    return true;
 }
 
 bool boardContainsWord(Board *board, const char *word)
@@ -185,43 +715,137 @@ bool boardContainsWord(Board *board, const char *word)
         return false;
 
     int len = strlen(word);
-    int size = board->size;
-    boardInitFlag(board);
+    clearHighlight(board);
+    if (len == 0)
+        return false;
 
-    for (int r = 0; r < size; r++)
+    // the index is built once it pays for itself
+    if (!board->planes && !board->indexBuilt)
     {
-        for (int c = 0; c < size; c++)
-        {
-            // vertical
-            if (board->grid[r][c] == word[0])
-            {
-                if (size - r >= len)
-                {
-                    if (searchDirection(board, word, len, r, c, 1, 0)) // down
-                        return true;
-                    if (size - c >= len && searchDirection(board, word, len, r, c, 1, 1)) // down - right
-                        return true;
-                    if (c + 1 >= len && searchDirection(board, word, len, r, c, 1, -1)) // down - left
-                        return true;
-                }
-                if (r + 1 >= len)
-                {
-                    if (searchDirection(board, word, len, r, c, -1, 0)) // up
-                        return true;
-                    if (size - c >= len && searchDirection(board, word, len, r, c, -1, 1)) // up - right
-                        return true;
-                    if (c + 1 >= len && searchDirection(board, word, len, r, c, -1, -1)) // up - left
-                        return true;
-                }
-                if (size - c >= len && searchDirection(board, word, len, r, c, 0, 1)) // right
-                    return true;
-                if (c + 1 >= len && searchDirection(board, word, len, r, c, 0, -1)) // left
-                    return true;
-            }
-        }
+        if (board->nbScans < SCANS_BEFORE_INDEX)
+            board->nbScans++;
+        else
+            buildIndex(board);
     }
 
-    return false;
+    size_t start;
+    int d;
+    if (!findWord(board, word, len, &start, &d))
+        return false;
+
+    highlight(board, start, board->steps[d], (size_t)len);
+    return true;
+}
+
+bool boardBuildIndex(Board *board)
+{
+    if (!board->indexBuilt)
+        buildIndex(board);
+    return board->letterCells != NULL;
+}
+
+bool boardFindWord(const Board *board, const char *word, BoardMatch *match)
+{
+    if (board == NULL || word == NULL || word[0] == '\0')
+        return false;
+
+    size_t start;
+    int d;
+    if (!findWord(board, word, (int)strlen(word), &start, &d))
+        return false;
+
+    match->row = start / board->width - BORDER;
+    match->col = start % board->width - BORDER;
+    match->incr = directions[d][0];
+    match->incc = directions[d][1];
+    match->length = strlen(word);
+    return true;
+}
+
+void boardHighlightMatch(Board *board, const BoardMatch *match)
+{
+    if (match == NULL)
+    {
+        clearHighlight(board);
+        return;
+    }
+    highlight(board, cellIndex(board, match->row, match->col),
+              directionStep(board, match->incr, match->incc), match->length);
+}
+
+uint32_t boardLetterMask(const char *word)
+{
+    uint32_t mask = 0;
+    for (size_t i = 0; word[i] != '\0'; i++)
+    {
+        if (word[i] >= 'a' && word[i] <= 'z')
+            mask |= UINT32_C(1) << (word[i] - 'a');
+        else
+            mask |= BOARD_OTHER_LETTERS;
+    }
+    return mask;
+}
+
+bool boardMayContainWord(const Board *board, const char *word, uint32_t mask)
+{
+    if (mask & ~board->presence)
+        return false;
+
+    size_t length = strlen(word);
+    if (length > board->size)
+        return false;
+    if ((mask & board->scarce) == 0)
+        return true;
+
+    size_t count[26] = {0};
+    for (size_t i = 0; i < length; i++)
+    {
+        if (word[i] >= 'a' && word[i] <= 'z' && ++count[word[i] - 'a'] > board->letterCount[word[i] - 'a'])
+            return false;
+    }
+    return true;
+}
+
+List *boardGetAllWordsFromLexicon(const Board *board, const char *const *words, const uint32_t *masks,
+                                   size_t nbWords, size_t nbThreads, size_t *nbPruned)
+{
+    LexiconSearch search = {board, words, masks, nbWords, PTHREAD_MUTEX_INITIALIZER, 0, NULL};
+    search.found = calloc(nbWords ? nbWords : 1, sizeof(unsigned char));
+    List *result = listNew();
+    if (!search.found || !result)
+    {
+        free(search.found);
+        if (result)
+            listFree(result, true);
+        return NULL;
+    }
+
+    // all the threads share the search, a worker left without words returns
+    parallelRun(lexiconWorker, &search, 0, parallelNbThreads(nbThreads));
+    pthread_mutex_destroy(&search.lock);
+
+    // the words found are gathered in the order of the lexicon
+    bool failed = false;
+    *nbPruned = 0;
+    for (size_t i = 0; i < nbWords && !failed; i++)
+    {
+        *nbPruned += search.found[i] == 2;
+        if (search.found[i] != 1)
+            continue;
+
+        char *copy = malloc(strlen(words[i]) + 1);
+        failed = !copy || !listInsertLast(result, memcpy(copy, words[i], strlen(words[i]) + 1));
+        if (failed)
+            free(copy);
+    }
+
+    free(search.found);
+    if (failed)
+    {
+        listFree(result, true);
+        return NULL;
+    }
+    return result;
 }
 
 void boardDisplay(Board *board)
@@ -237,10 +861,10 @@ void boardDisplay(Board *board)
             printf("\t");
 
             for (size_t j = 0; j < board->size; j++)
-                if (board->flag[i][j])
-                    printf(":[%c]", board->grid[i][j]);
+                if (board->flag[cellIndex(board, i, j)])
+                    printf(":[%c]", board->grid[cellIndex(board, i, j)]);
                 else
-                    printf(": %c ", board->grid[i][j]);
+                    printf(": %c ", board->grid[cellIndex(board, i, j)]);
             printf(":\n");
             printf("\t");
             for (size_t j = 0; j < board->size; j++)
@@ -258,12 +882,46 @@ void boardDisplay(Board *board)
 
 /* Student code starts here */
 
+/* Structures */
+
+typedef struct FoundWords_t // context of addFoundWord and addScannedWord
+{
+    Set *filledSet;  // words already found (used for checking duplicates)
+    List *wordsList; // found words, in the order they were found
+    char *word;      // buffer of at least size + 1 characters
+} FoundWords;
+
+typedef struct LineQueue_t // lines left to a worker of the parallel search
+{
+    pthread_mutex_t lock;
+    size_t begin;    // the owner takes the lines from begin,
+    size_t end;      // the other workers steal them from end
+} LineQueue;
+
+typedef struct SearchWorker_t // context of a thread of the parallel search
+{
+    Set *set;
+    const char *lines;       // the buffer of boardGetAllLines
+    const size_t *starts;    // offset of each line in lines
+    LineQueue *queues;       // the queues of all the workers
+    size_t nbWorkers;
+    size_t id;               // the queue of this worker is queues[id]
+    FoundWords found;        // words found by this worker only
+    bool ready;              // found is allocated, otherwise the worker does not search
+    bool failed;
+} SearchWorker;
+
 /* Prototypes */
 
 static char *duplicate_string(const char *str);
-static bool isInBoard(int r, int c, int size);
-static bool getWord(Board *board, char *word, int r, int c, int incr, int incc);
-static void addFoundPrefixes(Board *board, Set* set, Set* filledSet, List* wordsList, int r, int c, int incr, int incc);
+static size_t extractLines(const Board *board, ptrdiff_t step, char *lines);
+static char *boardGetAllLines(const Board *board, size_t *length);
+static bool foundWordsInit(FoundWords *found, const Board *board);
+static void foundWordsRelease(FoundWords *found);
+static bool addFoundWord(const char *key, size_t length, void *context);
+static bool addScannedWord(const char *key, size_t length, void *context);
+static bool takeLine(SearchWorker *worker, size_t *line);
+static void *searchWorker(void *context);
 
 /* static functions */
 
@@ -285,163 +943,378 @@ static char *duplicate_string(const char *str)
 }
 
 /**
- * @brief Checks if a given position is valid in the grid (board)
+ * @brief Copies into lines every line of the board read in the direction given
+ *        by step, each one followed by a '\0'.
  *
- * @param r row
- * @param c column
- * @param size size of the grid
- * 
- * @return bool : true if the pos is valid
- *                false itherwise
+ * @param board       a pointer to a board
+ * @param step        the direction step (see directionStep)
+ * @param lines       the destination buffer
+ * @return size_t     the number of characters written (terminators included)
  */
-static bool isInBoard(int r, int c, int size){
-    return r >= 0 && r < size
-        && c >= 0 && c < size;
+static size_t extractLines(const Board *board, ptrdiff_t step, char *lines){
+    size_t n = board->size;
+    size_t length = 0;
+
+    for (size_t r = 0; r < n; r++){
+        for (size_t c = 0; c < n; c++){
+            const char *cell = board->grid + cellIndex(board, r, c);
+            if (cell[-step] != '\0') // not the first cell of a line
+                continue;
+
+            while (*cell != '\0'){ // stops on the sentinel ring
+                lines[length++] = *cell;
+                cell += step;
+            }
+            lines[length++] = '\0';
+        }
+    }
+    return length;
 }
 
 /**
- * @brief return true if the word is found at position (r,c) in the direction
- *        obtained by incrementing row and column by incr and incc respetively
+ * @brief Materialises the rows, columns, diagonals and anti-diagonals of the
+ *        board, read in both directions, into one buffer of '\0'-terminated lines.
+ *        The buffer needs to be freed by the user.
  *
  * @param board       a pointer to a board
- * @param word        the word to be found
- * @param r           the starting row
- * @param c           the starting column
- * @param incr        the row increment
- * @param incc        the column increment
- * @return true       if the word is found
- * @return false      otherwise
+ * @param length      set to the number of characters of the buffer
+ * @return char*      the buffer, or NULL in case of allocation error
  */
-static bool getWord(Board *board, char *word, int r, int c, int incr, int incc){
-    int i = 0;
-    int sr = r;
-    int sc = c;
+static char *boardGetAllLines(const Board *board, size_t *length){
+    // every cell once per direction, plus at most 2n - 1 terminators per direction
     size_t n = board->size;
-    if (isInBoard(sr + incr, sc + incc, n)){
+    char *lines = malloc(NB_DIRECTIONS * (n * n + 2 * n) * sizeof(char));
+    if (!lines)
+        return NULL;
 
-        word[i] = board->grid[sr][sc];
-        while (isInBoard(sr + incr, sc + incc, n)){ 
+    *length = 0;
+    for (int d = 0; d < NB_DIRECTIONS; d++)
+        *length += extractLines(board, board->steps[d], lines + *length);
 
-            sr += incr;
-            sc += incc;
-            i++;
-            word[i] = board->grid[sr][sc];
-        }
-        word[i+1] = '\0';
-        return true;
+    return lines;
+}
+
+
+/**
+ * @brief Allocates the context of addFoundWord, with an empty list of found words
+ *
+ * @param found a pointer to the context to initialise
+ * @param board a pointer to the board where the words are searched
+ *
+ * @return bool : false in case of allocation error (nothing is left allocated)
+ */
+static bool foundWordsInit(FoundWords *found, const Board *board){
+    found->filledSet = setCreateEmpty(); // for duplicates
+    found->wordsList = listNew(); // contains found words in the grid
+    found->word = malloc(board->size + 1); // a word is at most one line long
+
+    if (!found->filledSet || !found->wordsList || !found->word){
+        if (found->filledSet)
+            setFree(found->filledSet);
+        if (found->wordsList)
+            listFree(found->wordsList, true);
+        free(found->word);
+        return false;
     }
-    return false;
+    return true;
 }
 
+/**
+ * @brief Frees the context of addFoundWord, except the list of found words
+ *
+ * @param found a pointer to a context initialised by foundWordsInit
+ */
+static void foundWordsRelease(FoundWords *found){
+    free(found->word);
+    setFree(found->filledSet);
+}
 
 /**
- * @brief Searches for a word forming a line on the grid, and then adds to a list all its prefixes found in the set.
+ * @brief SetVisitor adding a word found on the board to the list of found
+ *        words, unless it was already found.
  * 
- * @param board a pointer to a board
- * @param set a pointer to a set
- * @param filledSet a pointer to a set (used for checking duplicates)
- * @param wordsList a pointer to a list (will contain found prefixes in the set)
- * @param r starting row 
- * @param c starting column
- * @param incr the row increment
- * @param incc the column increment
- *
+ * @param key the word found
+ * @param length the length of the word
+ * @param context a pointer to a FoundWords
+ * 
+ * @return bool : true if the word was handled
+ *                false in case of allocation error
  */
-static void addFoundPrefixes(Board *board, Set* set, Set* filledSet, List* wordsList, int r, int c, int incr, int incc){
-    size_t n = board->size;
-    char *word = malloc((sizeof(char) * n + 1));
-    if (!word){
-        boardFree(board);
-        setFree(set);
-        setFree(filledSet);
-        listFree(wordsList, true);
-        terminate("Failed to allocate memory for word");
+static bool addFoundWord(const char *key, size_t length, void *context){
+    FoundWords *found = context;
+
+    memcpy(found->word, key, length);
+    found->word[length] = '\0';
+
+    int inserted = setInsert(found->filledSet, found->word);
+    if (inserted != 1)
+        return inserted == 0;
+
+    char *copy = duplicate_string(found->word);
+    if (!copy)
+        return false;
+
+    if (!listInsertLast(found->wordsList, copy)){
+        free(copy);
+        return false;
     }
+    return true;
+}
 
-    if (getWord(board, word, r, c, incr, incc)){
+/**
+ * @brief SetVisitor adding a word found by acScan in a line, as addFoundWord.
+ *        A word of one letter ending the line is skipped, as the search driven
+ *        by the board only starts at letters followed by another one.
+ *
+ * @param key the word found, pointing into the line
+ * @param length the length of the word
+ * @param context a pointer to a FoundWords
+ *
+ * @return bool : false in case of allocation error
+ */
+static bool addScannedWord(const char *key, size_t length, void *context){
+    if (length == 1 && key[1] == '\0')
+        return true;
+    return addFoundWord(key, length, context);
+}
 
-        List *foundPrefixes = setGetAllStringPrefixes(set, word);
+/**
+ * @brief Gives the next line to search to a worker: the first line of its own
+ *        queue, or else the last one of the upper half of the largest queue
+ *        of the others, the rest of that half becoming its own queue. Since
+ *        the lines only move from a queue to another, the search is over
+ *        when all the queues are seen empty.
+ *
+ * @param worker a pointer to a worker
+ * @param line set to the index of the line
+ *
+ * @return bool : false if there is no line left
+ */
+static bool takeLine(SearchWorker *worker, size_t *line){
+    LineQueue *own = &worker->queues[worker->id];
+
+    pthread_mutex_lock(&own->lock);
+    bool found = own->begin < own->end;
+    if (found)
+        *line = own->begin++;
+    pthread_mutex_unlock(&own->lock);
+    if (found)
+        return true;
 
-        if (!foundPrefixes){
-            boardFree(board);
-            setFree(set);
-            setFree(filledSet);
-            listFree(wordsList, true);
-            listFree(foundPrefixes, true);
-            terminate("Failed to get prefixes of the word");
-        }
-        for (LNode *p = foundPrefixes->head; p != NULL; p = p->next){
-
-            char *copy = duplicate_string(p->value);
-            if (!copy){
-                boardFree(board);
-                setFree(set);
-                setFree(filledSet);
-                listFree(wordsList, true);
-                listFree(foundPrefixes, true);
-                terminate("Failed to duplicate string");
+    while (true){
+        // the victim is chosen without locking: its size is only a hint
+        size_t victim = worker->nbWorkers, largest = 0;
+        for (size_t i = 0; i < worker->nbWorkers; i++){
+            LineQueue *queue = &worker->queues[i];
+            pthread_mutex_lock(&queue->lock);
+            size_t left = queue->end - queue->begin;
+            pthread_mutex_unlock(&queue->lock);
+            if (i != worker->id && left > largest){
+                largest = left;
+                victim = i;
             }
+        }
+        if (victim == worker->nbWorkers)
+            return false;
+
+        LineQueue *queue = &worker->queues[victim];
+        pthread_mutex_lock(&queue->lock);
+        size_t left = queue->end - queue->begin;
+        size_t begin = queue->end - (left + 1) / 2, end = queue->end;
+        queue->end = begin;
+        pthread_mutex_unlock(&queue->lock);
+        if (begin == end) // emptied in the meantime, try again
+            continue;
+
+        *line = end - 1;
+        pthread_mutex_lock(&own->lock);
+        own->begin = begin;
+        own->end = end - 1;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+}
 
-            if (setInsert(filledSet, copy) == 1){
-
-                if (!listInsertLast(wordsList, copy)){ 
-                    free(copy);
-                    boardFree(board);
-                    setFree(set);
-                    setFree(filledSet);
-                    listFree(wordsList, true);
-                    listFree(foundPrefixes, true);
-                    terminate("Failed to add matching word to list");
-                }
-            }
-            else {
-                free(copy);
+/**
+ * @brief Thread of the parallel search: searches the lines it takes, as
+ *        boardGetAllWordsFromSet does, into its own FoundWords.
+ *
+ * @param context a pointer to a SearchWorker
+ *
+ * @return void* : NULL
+ */
+static void *searchWorker(void *context){
+    SearchWorker *worker = context;
+
+    size_t line;
+    while (worker->ready && !worker->failed && takeLine(worker, &line)){
+        for (const char *start = worker->lines + worker->starts[line]; start[0] != '\0' && start[1] != '\0'; start++){
+            if (!setVisitAllStringPrefixes(worker->set, start, addFoundWord, &worker->found)){
+                worker->failed = true;
+                break;
             }
         }
-
-        listFree(foundPrefixes, true);
     }
-    free(word);
+    return NULL;
 }
 
 List *boardGetAllWordsFromSet(Board *board, Set *set)
 {
-    Set *filledSet = setCreateEmpty(); // for duplicates
-    if (!filledSet){
+    size_t length;
+    char *lines = boardGetAllLines(board, &length); // every line, read once
+    if (!lines){
         printf("Failed to get words from set\n");
         return NULL;
     }
 
-    List *wordsList = listNew(); // contains found words in the grid
-    if (!wordsList){
+    FoundWords found;
+    if (!foundWordsInit(&found, board)){
         printf("Failed to get words from set\n");
-        setFree(filledSet);
+        free(lines);
         return NULL;
     }
 
-    size_t n = board->size;
-    for (size_t i = 0; i < n; i++){
-        for (size_t j = 0; j < n; j++){
+    // each start (cell, direction) is a position of the buffer followed by at
+    // least one more letter of the same line
+    for (size_t i = 0; i + 1 < length; i++){
+        if (lines[i] == '\0' || lines[i + 1] == '\0')
+            continue;
+
+        if (!setVisitAllStringPrefixes(set, lines + i, addFoundWord, &found)){
+            boardFree(board);
+            setFree(set);
+            foundWordsRelease(&found);
+            listFree(found.wordsList, true);
+            terminate("Failed to add matching word to list");
+        }
+    }
+    foundWordsRelease(&found);
+    free(lines);
+
+    return found.wordsList;
+}
+
+List *boardGetAllWordsFromSetParallel(Board *board, Set *set, size_t nbThreads)
+{
+    nbThreads = parallelNbThreads(nbThreads);
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, 0, 1); // right
+    // a single worker would only add the queues and the merge to the serial search
+    if (nbThreads == 1)
+        return boardGetAllWordsFromSet(board, set);
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, 0, -1); // left
+    size_t length;
+    char *lines = boardGetAllLines(board, &length); // every line, read once
+    if (!lines){
+        printf("Failed to get words from set\n");
+        return NULL;
+    }
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, -1, 0); // up
+    // offsets of the lines of at least 2 letters, the only ones with a start
+    size_t nbLines = 0;
+    size_t *starts = malloc((length / 3 + 1) * sizeof(size_t));
+    SearchWorker *workers = calloc(nbThreads, sizeof(SearchWorker));
+    LineQueue *queues = malloc(nbThreads * sizeof(LineQueue));
+    FoundWords merged;
+    if (!starts || !workers || !queues || !foundWordsInit(&merged, board)){
+        printf("Failed to get words from set\n");
+        free(starts);
+        free(workers);
+        free(queues);
+        free(lines);
+        return NULL;
+    }
+    for (size_t i = 0; i < length; i += strlen(lines + i) + 1){
+        if (lines[i] != '\0' && lines[i + 1] != '\0')
+            starts[nbLines++] = i;
+    }
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, 1, 0); // down
+    // the lines are first shared out in blocks of about the same number of letters
+    size_t line = 0;
+    for (size_t w = 0; w < nbThreads; w++){
+        pthread_mutex_init(&queues[w].lock, NULL);
+        queues[w].begin = line;
+        size_t limit = (w + 1) * length / nbThreads;
+        while (line < nbLines && (starts[line] < limit || w == nbThreads - 1))
+            line++;
+        queues[w].end = line;
+    }
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, -1, 1); // up-right
+    size_t nbReady = 0;
+    for (size_t w = 0; w < nbThreads; w++){
+        SearchWorker *worker = &workers[w];
+        worker->set = set;
+        worker->lines = lines;
+        worker->starts = starts;
+        worker->queues = queues;
+        worker->nbWorkers = nbThreads;
+        worker->id = w;
+        worker->ready = foundWordsInit(&worker->found, board);
+        if (worker->ready)
+            nbReady++;
+    }
+    // the lines of a worker that is not ready are stolen by the others
+    bool failed = nbReady == 0;
+    if (!failed)
+        parallelRun(searchWorker, workers, sizeof(SearchWorker), nbThreads);
+
+    // merge, each word found by several workers being kept once
+    for (size_t w = 0; w < nbThreads; w++){
+        SearchWorker *worker = &workers[w];
+        if (!worker->ready)
+            continue;
+        failed = failed || worker->failed;
+
+        for (LNode *p = worker->found.wordsList->head; p != NULL && !failed; p = p->next)
+            failed = !addFoundWord(p->value, strlen(p->value), &merged);
+        foundWordsRelease(&worker->found);
+        listFree(worker->found.wordsList, true);
+    }
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, 1, -1); // down-left
+    for (size_t w = 0; w < nbThreads; w++)
+        pthread_mutex_destroy(&queues[w].lock);
+    free(starts);
+    free(workers);
+    free(queues);
+    free(lines);
+    foundWordsRelease(&merged);
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, -1, -1); // up-left
+    if (failed){
+        boardFree(board);
+        setFree(set);
+        listFree(merged.wordsList, true);
+        terminate("Failed to add matching word to list");
+    }
+    return merged.wordsList;
+}
 
-            addFoundPrefixes(board, set, filledSet, wordsList, i, j, 1, 1); // down-right
-        }
+List *boardGetAllWordsFromAutomaton(Board *board, const AhoCorasick *ac)
+{
+    size_t length;
+    char *lines = boardGetAllLines(board, &length); // every line, read once
+    if (!lines){
+        printf("Failed to get words from automaton\n");
+        return NULL;
+    }
 
+    FoundWords found;
+    if (!foundWordsInit(&found, board)){
+        printf("Failed to get words from automaton\n");
+        free(lines);
+        return NULL;
+    }
+
+    // a single pass per line finds the words starting at every cell of it
+    for (size_t i = 0; i < length; i += strlen(lines + i) + 1){
+        if (!acScan(ac, lines + i, addScannedWord, &found)){
+            boardFree(board);
+            foundWordsRelease(&found);
+            listFree(found.wordsList, true);
+            free(lines);
+            terminate("Failed to add matching word to list");
+        }
     }
-    setFree(filledSet);
+    foundWordsRelease(&found);
+    free(lines);
 
-    return wordsList;
+    return found.wordsList;
 }
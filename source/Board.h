@@ -3,12 +3,27 @@
 #define _BOARD_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "AhoCorasick.h"
 #include "List.h"
 #include "Set.h"
 
 /* Board (opaque) structure */
 typedef struct Board_t Board;
 
+/* A word found by boardFindWord */
+typedef struct BoardMatch_t
+{
+    size_t row;    // the cell of its first letter
+    size_t col;
+    int incr;      // the direction, as row and column increments in {-1, 0, 1}
+    int incc;
+    size_t length; // the number of letters
+} BoardMatch;
+
+/* Bit of boardLetterMask standing for all the characters other than 'a'..'z' */
+#define BOARD_OTHER_LETTERS (UINT32_C(1) << 26)
+
 /**
  * @brief Create a square board. If 'letters' is NULL, the board is filled in with random letters.
  *        Otherwise, it is filled in with the content of 'letters' (row-major order).
@@ -26,6 +41,19 @@ Board *boardCreate(size_t size, const char *letters);
  */
 void boardFree(Board *board);
 
+/**
+ * @brief Make boardContainsWord use bitplanes, one per letter, which test 64
+ *        start cells at once instead of walking from the candidate cells given
+ *        by an index of the letters. The planes take 26 bits per cell where the
+ *        index takes 36 bytes, but every start cell is tested for each word.
+ *
+ * @param board            A pointer to a board
+ * @return true            if the bitplanes are used
+ * @return false           if the board holds characters other than 'a'..'z',
+ *                         or in case of allocation error (the board is unchanged)
+ */
+bool boardUseBitboards(Board *board);
+
 /**
  * @brief Return true if the word appears in the board, false otherwise.
  *
@@ -36,6 +64,83 @@ void boardFree(Board *board);
  */
 bool boardContainsWord(Board *board, const char *word);
 
+/**
+ * @brief Same as boardContainsWord, except that the board is not modified: the
+ *        place of the word is returned instead of being highlighted, and the
+ *        index of the letters is never built (see boardBuildIndex). It can be
+ *        called from several threads at once on the same board.
+ *
+ * @param board            A pointer to a board
+ * @param word             A valid string
+ * @param match            Set to the place of the word if it is found
+ * @return true            if the word is contained in the board
+ * @return false           if the word does not appear in the board
+ */
+bool boardFindWord(const Board *board, const char *word, BoardMatch *match);
+
+/**
+ * @brief Build now the index of the letters that boardContainsWord builds
+ *        once enough words were searched, so that boardFindWord uses it.
+ *
+ * @param board            A pointer to a board
+ * @return true            if the index is built
+ * @return false           in case of allocation error (the grid is then scanned)
+ */
+bool boardBuildIndex(Board *board);
+
+/**
+ * @brief Return the words of a lexicon that appear in the board, searched by
+ *        several threads with boardMayContainWord and boardFindWord. Each
+ *        thread takes the words by chunks; the list holds copies of the words
+ *        found, in the order of the lexicon. Call boardBuildIndex (or
+ *        boardUseBitboards) first, the board being only read. The returned list
+ *        and its content needs to be freed by the user.
+ *
+ * @param board            A pointer to a board
+ * @param words            The words of the lexicon
+ * @param masks            boardLetterMask of each word
+ * @param nbWords          The number of words
+ * @param nbThreads        The number of threads, 0 for one per online processor
+ * @param nbPruned         Set to the number of words rejected by boardMayContainWord
+ * @return List*           The words found, or NULL in case of allocation error
+ */
+List *boardGetAllWordsFromLexicon(const Board *board, const char *const *words, const uint32_t *masks,
+                                   size_t nbWords, size_t nbThreads, size_t *nbPruned);
+
+/**
+ * @brief Highlight the word found by boardFindWord, for the next boardDisplay,
+ *        in place of the last word highlighted.
+ *
+ * @param board            A pointer to a board
+ * @param match            A place returned by boardFindWord, or NULL to only
+ *                         remove the highlighting
+ */
+void boardHighlightMatch(Board *board, const BoardMatch *match);
+
+/**
+ * @brief Return the letters used by a word: bit i is set if the word contains
+ *        the letter 'a' + i, and BOARD_OTHER_LETTERS if it contains any other
+ *        character. Meant to be computed once per word of a lexicon.
+ *
+ * @param word             A valid string
+ * @return uint32_t        The mask of the letters of the word
+ */
+uint32_t boardLetterMask(const char *word);
+
+/**
+ * @brief Return false if the word cannot appear in the board, without looking
+ *        at the grid: it is longer than a line, it needs a letter the board
+ *        lacks, or more copies of a letter than the board has. Only the last
+ *        check reads the word, and only if it has a letter that is rare on the board.
+ *
+ * @param board            A pointer to a board
+ * @param word             A valid string
+ * @param mask             boardLetterMask(word)
+ * @return true            if boardContainsWord may find the word
+ * @return false           if boardContainsWord would not find the word
+ */
+bool boardMayContainWord(const Board *board, const char *word, uint32_t mask);
+
 /**
  * @brief Display the board. If boardContainsWord was called before and the word was found,
  *        the letters corresponding to that word are highlighted on the board.
@@ -56,4 +161,32 @@ void boardDisplay(Board *board);
  */
 List *boardGetAllWordsFromSet(Board *board, Set *set);
 
+/**
+ * @brief Return the same list of words as boardGetAllWordsFromSet, searched by
+ *        several threads. Each one searches whole lines into its own list and
+ *        set of found words, taking the lines left to the others when it has
+ *        none left (the lines differ in length), and the lists are merged at the
+ *        end. The set is only read, concurrently. With a single thread, the
+ *        search is that of boardGetAllWordsFromSet. The returned list and its
+ *        content needs to be freed by the user.
+ *
+ * @param board            A pointer to a board
+ * @param set              A set containing words
+ * @param nbThreads        The number of threads, 0 for one per online processor
+ * @return List*           A list of strings corresponding to the word on the board
+ */
+List *boardGetAllWordsFromSetParallel(Board *board, Set *set, size_t nbThreads);
+
+/**
+ * @brief Return the same list of words as boardGetAllWordsFromSet, the set being
+ *        replaced by the automaton of its keys: each line of the board is read
+ *        once instead of once per cell. The returned list and its content needs
+ *        to be freed by the user.
+ *
+ * @param board            A pointer to a board
+ * @param ac               The automaton of a set containing words
+ * @return List*           A list of strings corresponding to the word on the board
+ */
+List *boardGetAllWordsFromAutomaton(Board *board, const AhoCorasick *ac);
+
 #endif // !_BOARD_H_
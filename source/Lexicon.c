@@ -0,0 +1,312 @@
+/* ========================================================================= *
+ * Lexicon
+ *
+ * Mapping of a lexicon file and search of its lines (see Lexicon.h).
+ *
+ * The file is split into one chunk per thread and read twice. The first pass
+ * counts the newlines of each chunk, which gives every chunk the index of its
+ * first word and the start of the line it begins in; the second pass, once
+ * the array of words is allocated at its final size, fills it in place.
+ * ========================================================================= */
+
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+
+#include "Lexicon.h"
+#include "Parallel.h"
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(PAIRSCAN_SCALAR) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEXICON_X86 1
+#include <immintrin.h>
+#endif
+
+#define MIN_CHUNK_SIZE (1 << 20) // smaller files are read by fewer threads
+#ifdef MAP_POPULATE
+#define MAP_TEXT (MAP_PRIVATE | MAP_FIXED | MAP_POPULATE) // every page is written, fault them at once
+#else
+#define MAP_TEXT (MAP_PRIVATE | MAP_FIXED)
+#endif
+#define NO_LINE SIZE_MAX
+
+/* Structures */
+
+struct Lexicon_t
+{
+    char *text;         // the private mapping of the file, newlines replaced by \0
+    size_t length;      // length of the mapping
+    LexiconWord *words;
+    size_t nbWords;
+};
+
+typedef struct Chunk_t
+{
+    char *text;
+    LexiconWord *words;  // NULL during the first pass
+    size_t from;         // first position of the chunk
+    size_t to;           // end of the chunk
+    size_t nbLines;      // first pass: number of newlines in the chunk
+    size_t openLine;     // first pass: start of the line open at the end of the chunk, NO_LINE if
+                         // the chunk has no newline
+    size_t first;        // second pass: index of the next word ending in the chunk
+    size_t lineStart;    // second pass: start of that word
+} Chunk;
+
+/* Prototypes */
+
+static void addNewlines(Chunk *chunk, size_t base, uint32_t mask);
+static void scanScalar(Chunk *chunk, size_t from);
+#ifdef LEXICON_X86
+static void scanSse2(Chunk *chunk);
+static void scanAvx2(Chunk *chunk);
+#endif
+static void *scanChunk(void *chunk);
+static char *mapText(const char *filename, size_t *size, size_t *length);
+
+/* static functions */
+
+/**
+ * @brief Account for the newlines of a block of the text, given as a mask:
+ *        counted during the first pass, turned into words during the second.
+ *
+ * @param chunk    The chunk read
+ * @param base     The position of the block
+ * @param mask     Bit i is set if there is a newline at base + i
+ */
+static void addNewlines(Chunk *chunk, size_t base, uint32_t mask)
+{
+    if (!chunk->words)
+    {
+        if (mask)
+        {
+            chunk->nbLines += (size_t)__builtin_popcount(mask);
+            chunk->openLine = base + (size_t)(32 - __builtin_clz(mask));
+        }
+        return;
+    }
+
+    for (; mask; mask &= mask - 1)
+    {
+        size_t end = base + (size_t)__builtin_ctz(mask);
+        chunk->text[end] = '\0';
+        chunk->words[chunk->first].offset = (uint32_t)chunk->lineStart;
+        chunk->words[chunk->first].length = (uint32_t)(end - chunk->lineStart);
+        chunk->first++;
+        chunk->lineStart = end + 1;
+    }
+}
+
+/**
+ * @brief Read a chunk one character at a time, also used for the last
+ *        positions of the vector kernels
+ *
+ * @param chunk    The chunk read
+ * @param from     The first position read, in the chunk
+ */
+static void scanScalar(Chunk *chunk, size_t from)
+{
+    for (size_t p = from; p < chunk->to; p++)
+    {
+        if (chunk->text[p] == '\n')
+            addNewlines(chunk, p, 1);
+    }
+}
+
+#ifdef LEXICON_X86
+
+/**
+ * @brief Read a chunk 16 characters at a time
+ */
+__attribute__((target("sse2")))
+static void scanSse2(Chunk *chunk)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    size_t p = chunk->from;
+    for (; p + 16 <= chunk->to; p += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(chunk->text + p));
+        addNewlines(chunk, p, (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, newline)));
+    }
+    scanScalar(chunk, p);
+}
+
+/**
+ * @brief Read a chunk 32 characters at a time
+ */
+__attribute__((target("avx2")))
+static void scanAvx2(Chunk *chunk)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    size_t p = chunk->from;
+    for (; p + 32 <= chunk->to; p += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(chunk->text + p));
+        addNewlines(chunk, p, (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, newline)));
+    }
+    scanScalar(chunk, p);
+}
+
+#endif
+
+/**
+ * @brief Thread reading a chunk with the best kernel of the processor
+ *
+ * @param chunk    A pointer to a Chunk
+ * @return void*   NULL
+ */
+static void *scanChunk(void *chunk)
+{
+#ifdef LEXICON_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scanAvx2(chunk);
+        return NULL;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        scanSse2(chunk);
+        return NULL;
+    }
+#endif
+    Chunk *scanned = chunk;
+    scanScalar(scanned, scanned->from);
+    return NULL;
+}
+
+/**
+ * @brief Map a file in a private mapping followed by at least one \0, which
+ *        ends the last word when the file has no final newline
+ *
+ * @param filename The name of the file
+ * @param size     Set to the size of the file
+ * @param length   Set to the length of the mapping
+ * @return char*   The mapping, or NULL in case of error
+ */
+static char *mapText(const char *filename, size_t *size, size_t *length)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t)info.st_size >= UINT32_MAX)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // the file is mapped over zeroed pages: past its end, the last page of the
+    // file reads as zeros too
+    long page = sysconf(_SC_PAGESIZE);
+    *size = (size_t)info.st_size;
+    *length = (*size / (size_t)page + 1) * (size_t)page;
+    char *text = mmap(NULL, *length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (text != MAP_FAILED && *size > 0 &&
+        mmap(text, *size, PROT_READ | PROT_WRITE, MAP_TEXT, fd, 0) == MAP_FAILED)
+    {
+        munmap(text, *length);
+        text = MAP_FAILED;
+    }
+    close(fd);
+    return text == MAP_FAILED ? NULL : text;
+}
+
+/* header functions */
+
+Lexicon *lexiconOpen(const char *filename, size_t nbThreads)
+{
+    nbThreads = parallelNbThreads(nbThreads);
+
+    Lexicon *lexicon = malloc(sizeof(Lexicon));
+    if (!lexicon)
+        return NULL;
+
+    size_t size;
+    lexicon->words = NULL;
+    lexicon->text = mapText(filename, &size, &lexicon->length);
+    if (!lexicon->text)
+    {
+        free(lexicon);
+        return NULL;
+    }
+
+    size_t nbChunks = size / MIN_CHUNK_SIZE < nbThreads ? size / MIN_CHUNK_SIZE : nbThreads;
+    if (nbChunks == 0)
+        nbChunks = 1;
+    Chunk *chunks = malloc(nbChunks * sizeof(Chunk));
+    if (!chunks)
+    {
+        lexiconClose(lexicon);
+        return NULL;
+    }
+
+    // first pass: the newlines of each chunk are counted
+    for (size_t t = 0; t < nbChunks; t++)
+        chunks[t] = (Chunk){lexicon->text, NULL, size * t / nbChunks, size * (t + 1) / nbChunks, 0, NO_LINE, 0, 0};
+    parallelRun(scanChunk, chunks, sizeof(Chunk), nbChunks);
+
+    size_t first = 0, lineStart = 0;
+    for (size_t t = 0; t < nbChunks; t++)
+    {
+        chunks[t].first = first;
+        chunks[t].lineStart = lineStart;
+        first += chunks[t].nbLines;
+        if (chunks[t].openLine != NO_LINE)
+            lineStart = chunks[t].openLine;
+    }
+
+    // the last line may have no newline
+    lexicon->nbWords = first + (lineStart < size ? 1 : 0);
+    lexicon->words = malloc((lexicon->nbWords ? lexicon->nbWords : 1) * sizeof(LexiconWord));
+    if (!lexicon->words)
+    {
+        free(chunks);
+        lexiconClose(lexicon);
+        return NULL;
+    }
+
+    // second pass: the words ending in each chunk are written
+    for (size_t t = 0; t < nbChunks; t++)
+        chunks[t].words = lexicon->words;
+    parallelRun(scanChunk, chunks, sizeof(Chunk), nbChunks);
+
+    if (lineStart < size)
+    {
+        lexicon->words[first].offset = (uint32_t)lineStart;
+        lexicon->words[first].length = (uint32_t)(size - lineStart);
+    }
+
+    free(chunks);
+    return lexicon;
+}
+
+void lexiconClose(Lexicon *lexicon)
+{
+    if (!lexicon)
+        return;
+
+    munmap(lexicon->text, lexicon->length);
+    free(lexicon->words);
+    free(lexicon);
+}
+
+size_t lexiconNbWords(const Lexicon *lexicon)
+{
+    return lexicon->nbWords;
+}
+
+const LexiconWord *lexiconWords(const Lexicon *lexicon)
+{
+    return lexicon->words;
+}
+
+const char *lexiconWord(const Lexicon *lexicon, size_t index)
+{
+    return lexicon->text + lexicon->words[index].offset;
+}
@@ -0,0 +1,70 @@
+#ifndef _LEXICON_H_
+#define _LEXICON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A lexicon file (one word per line) mapped in memory. The lines are found by
+ * several threads at once, 16 or 32 characters at a time with SSE2 or AVX2 as
+ * in PairScan.h, and each newline is replaced by a \0 in a private copy of the
+ * mapping, so that the words are used in place without any allocation per
+ * word. As with fgets, the last line counts even without a final newline.
+ */
+
+/** Lexicon (opaque) structure */
+typedef struct Lexicon_t Lexicon;
+
+/** A word of the lexicon, as a view into its text */
+typedef struct LexiconWord_t
+{
+    uint32_t offset; // position of the first character in the text
+    uint32_t length; // number of characters, without the \0
+} LexiconWord;
+
+/**
+ * @brief Map a lexicon file and find its words. Files of 4 GiB or more are
+ *        not supported. The returned lexicon needs to be closed with
+ *        lexiconClose, which invalidates all its words.
+ *
+ * @param filename     The name of a lexicon file
+ * @param nbThreads    The number of threads, 0 for one per online processor
+ * @return Lexicon*    The lexicon, or NULL if the file cannot be read or in
+ *                     case of allocation error
+ */
+Lexicon *lexiconOpen(const char *filename, size_t nbThreads);
+
+/**
+ * @brief Unmap a lexicon and free its words
+ *
+ * @param lexicon      A pointer to a lexicon, or NULL
+ */
+void lexiconClose(Lexicon *lexicon);
+
+/**
+ * @brief Return the number of words (lines) of a lexicon
+ *
+ * @param lexicon      A pointer to a lexicon
+ * @return size_t
+ */
+size_t lexiconNbWords(const Lexicon *lexicon);
+
+/**
+ * @brief Return the views of all the words of a lexicon, in the order of the
+ *        file
+ *
+ * @param lexicon      A pointer to a lexicon
+ * @return const LexiconWord* An array of lexiconNbWords(lexicon) views
+ */
+const LexiconWord *lexiconWords(const Lexicon *lexicon);
+
+/**
+ * @brief Return a word of a lexicon
+ *
+ * @param lexicon      A pointer to a lexicon
+ * @param index        The index of the word, less than lexiconNbWords(lexicon)
+ * @return const char* The word, followed by a \0
+ */
+const char *lexiconWord(const Lexicon *lexicon, size_t index);
+
+#endif // !_LEXICON_H_
@@ -0,0 +1,112 @@
+/* ========================================================================= *
+ * PairScan
+ *
+ * SSE2, AVX2 and scalar kernels of pairScanNext (see PairScan.h).
+ * ========================================================================= */
+
+#include "PairScan.h"
+#include <stdint.h>
+
+#if !defined(PAIRSCAN_SCALAR) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PAIRSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+/* Prototypes */
+
+static size_t nextScalar(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b);
+#ifdef PAIRSCAN_X86
+static size_t nextSse2(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b);
+static size_t nextAvx2(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b);
+#endif
+
+/* static functions */
+
+/**
+ * @brief pairScanNext one position at a time, also used for the last
+ *        positions of the vector kernels
+ */
+static size_t nextScalar(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b)
+{
+    for (size_t p = from; p < to; p++)
+    {
+        if (text[p] == a && text[p + step] == b)
+            return p;
+    }
+    return to;
+}
+
+#ifdef PAIRSCAN_X86
+
+/**
+ * @brief pairScanNext 16 positions at a time: both characters are compared to
+ *        16 consecutive positions, and the first bit of the AND of the two
+ *        masks is the position found.
+ */
+__attribute__((target("sse2")))
+static size_t nextSse2(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b)
+{
+    const __m128i first = _mm_set1_epi8(a);
+    const __m128i second = _mm_set1_epi8(b);
+
+    size_t p = from;
+    for (; p + 16 <= to; p += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(text + p));
+        __m128i y = _mm_loadu_si128((const __m128i *)(text + p + step));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(x, first),
+                                                                  _mm_cmpeq_epi8(y, second)));
+        if (mask)
+            return p + (size_t)__builtin_ctz(mask);
+    }
+    return nextScalar(text, p, to, step, a, b);
+}
+
+/**
+ * @brief pairScanNext 32 positions at a time, as nextSse2
+ */
+__attribute__((target("avx2")))
+static size_t nextAvx2(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b)
+{
+    const __m256i first = _mm256_set1_epi8(a);
+    const __m256i second = _mm256_set1_epi8(b);
+
+    size_t p = from;
+    for (; p + 32 <= to; p += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(text + p));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(text + p + step));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(x, first),
+                                                                        _mm256_cmpeq_epi8(y, second)));
+        if (mask)
+            return p + (size_t)__builtin_ctz(mask);
+    }
+    return nextScalar(text, p, to, step, a, b);
+}
+
+#endif
+
+/* header functions */
+
+size_t pairScanNext(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b)
+{
+#ifdef PAIRSCAN_X86
+    // the features are read once by libgcc at startup, testing them is cheap
+    if (__builtin_cpu_supports("avx2"))
+        return nextAvx2(text, from, to, step, a, b);
+    if (__builtin_cpu_supports("sse2"))
+        return nextSse2(text, from, to, step, a, b);
+#endif
+    return nextScalar(text, from, to, step, a, b);
+}
+
+const char *pairScanKernel(void)
+{
+#ifdef PAIRSCAN_X86
+    if (__builtin_cpu_supports("avx2"))
+        return "avx2";
+    if (__builtin_cpu_supports("sse2"))
+        return "sse2";
+#endif
+    return "scalar";
+}
@@ -0,0 +1,36 @@
+#ifndef _PAIRSCAN_H_
+#define _PAIRSCAN_H_
+
+#include <stddef.h>
+
+/*
+ * Search of a pair of characters a given distance apart in a buffer, 16 or 32
+ * positions at a time with SSE2 or AVX2. The kernel is chosen at run time
+ * according to the processor; compiling with -DPAIRSCAN_SCALAR forces the
+ * scalar one, for comparison.
+ */
+
+/**
+ * @brief Return the first position p in [from, to[ such that text[p] == a and
+ *        text[p + step] == b, or to if there is none. text[p + step] must be
+ *        readable for every p in [from, to[.
+ *
+ * @param text         A buffer
+ * @param from         The first position tried
+ * @param to           The end of the positions tried
+ * @param step         The distance from the first character to the second
+ * @param a            The first character
+ * @param b            The second character
+ * @return size_t      The position found, or to
+ */
+size_t pairScanNext(const char *text, size_t from, size_t to, ptrdiff_t step, char a, char b);
+
+/**
+ * @brief Return the name of the kernel used by pairScanNext: "avx2", "sse2"
+ *        or "scalar".
+ *
+ * @return const char*
+ */
+const char *pairScanKernel(void);
+
+#endif // !_PAIRSCAN_H_
@@ -0,0 +1,56 @@
+/* ========================================================================= *
+ * Parallel
+ *
+ * Threads of the searches and of the loaders (see Parallel.h).
+ * ========================================================================= */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "Parallel.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* header functions */
+
+size_t parallelNbThreads(size_t nbThreads)
+{
+    if (nbThreads > 0)
+        return nbThreads;
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (size_t)online : 1;
+}
+
+void parallelRun(void *(*work)(void *), void *tasks, size_t taskSize, size_t nbTasks)
+{
+    pthread_t *threads = malloc(nbTasks * sizeof(pthread_t));
+    bool *started = calloc(nbTasks, sizeof(bool));
+    char *task = tasks;
+
+    // without the arrays, the calling thread runs every task
+    for (size_t t = 1; threads && started && t < nbTasks; t++)
+        started[t] = pthread_create(&threads[t], NULL, work, task + t * taskSize) == 0;
+    for (size_t t = 0; t < nbTasks; t++)
+    {
+        if (!started || !started[t])
+            work(task + t * taskSize);
+    }
+    for (size_t t = 1; started && t < nbTasks; t++)
+    {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+    }
+
+    free(threads);
+    free(started);
+}
+
+long parallelWallClockMillis(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
@@ -0,0 +1,42 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <stddef.h>
+
+/*
+ * Runs a function over an array of tasks, one thread per task. The calling
+ * thread runs the first task itself, and also the tasks whose thread could not
+ * be created, so that every task is always run exactly once.
+ */
+
+/**
+ * @brief Return the number of threads to use for a requested number
+ *
+ * @param nbThreads    The number of threads requested, 0 for one per online
+ *                     processor
+ * @return size_t      nbThreads, or the number of online processors if it is
+ *                     0 (at least 1)
+ */
+size_t parallelNbThreads(size_t nbThreads);
+
+/**
+ * @brief Run work on every task and wait for all of them
+ *
+ * @param work         The function run by the threads, on a pointer to a task
+ * @param tasks        The array of tasks
+ * @param taskSize     The size of a task, 0 to give the same task to all the
+ *                     threads
+ * @param nbTasks      The number of tasks
+ */
+void parallelRun(void *(*work)(void *), void *tasks, size_t taskSize, size_t nbTasks);
+
+/**
+ * @brief Return the elapsed real time in ms from an arbitrary point, to time
+ *        the searches run by several threads: clock() counts the CPU time of
+ *        all the threads of the process.
+ *
+ * @return long        A monotonic time in ms
+ */
+long parallelWallClockMillis(void);
+
+#endif // !_PARALLEL_H_
@@ -6,9 +6,34 @@
 
 #include "List.h"
 
+/*
+ * The functions taking a const Set only read it: they may be called from
+ * several threads at once, as long as no thread modifies the set meanwhile.
+ */
+
 /** Set (opaque) structure */
 typedef struct Set_t Set;
 
+/** Cursor (opaque) structure, reading a string one character at a time */
+typedef struct SetCursor_t SetCursor;
+
+/**
+ * @brief Function called by setVisitAllStringPrefixes for each key found.
+ *
+ * @param key          The first length characters of key are the key found. They
+ *                     are not necessarily followed by a \0 and are only valid
+ *                     during the call (they may point into the set or into the
+ *                     visited string).
+ * @param length       The length of the key
+ * @param context      The context given to setVisitAllStringPrefixes
+ * @return bool        true to continue the visit, false to stop it
+ */
+typedef bool (*SetVisitor)(const char *key, size_t length, void *context);
+
+/** Flags returned by setCursorStep */
+#define SET_CURSOR_KEY 1    // the string read so far is a key of the set
+#define SET_CURSOR_PREFIX 2 // the string read so far is a proper prefix of a key
+
 /**
  * @brief Create an empty set. The returned set needs to be freed
  *        with setFree.
@@ -32,6 +57,17 @@ void setFree(Set *set);
  */
 size_t setNbKeys(const Set *set);
 
+/**
+ * @brief Returns the number of bytes used by the set, as requested from the
+ *        allocator (the overhead of the allocator itself is not counted).
+ *        Structures that only speed up the searches are included, such as
+ *        the prefix filters of the hash tables (2 bytes per bucket or slot).
+ *
+ * @param set         A pointer to a set
+ * @return size_t     the number of bytes
+ */
+size_t setMemoryUsage(const Set *set);
+
 /**
  * @brief Returns true if the key appears in the set, false otherwise.
  *
@@ -52,6 +88,19 @@ bool setContains(const Set *set, const char *key);
  */
 int setInsert(Set *set, const char *key);
 
+/**
+ * @brief Create a set holding the given keys, built in a single pass rather
+ *        than by successive insertions. The keys are expected in strcmp order,
+ *        as in a sorted lexicon; implementations that rely on the order sort
+ *        them first if they are not. Duplicates are ignored. A copy of the keys
+ *        will be done. The returned set needs to be freed with setFree.
+ *
+ * @param keys         An array of valid strings
+ * @param nbKeys       The number of strings
+ * @return Set*        a pointer to the set, or NULL in case of allocation error
+ */
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys);
+
 /**
  * @brief Return a list of all prefixes of the string that appears in the set.
  *        The list and all the keys it contains need to be freed by the user.
@@ -62,4 +111,92 @@ int setInsert(Set *set, const char *key);
  */
 List *setGetAllStringPrefixes(const Set *set, const char *string);
 
-#endif // !_SET_H_
\ No newline at end of file
+/**
+ * @brief Call visit on every prefix of the string that appears in the set, by
+ *        increasing length. Unlike setGetAllStringPrefixes, nothing is allocated.
+ *
+ * @param set          A pointer to a set
+ * @param string       A valid string (ending with a \0 character)
+ * @param visit        The function called for each prefix found
+ * @param context      Passed as is to visit
+ * @return bool        false if the visit was stopped by visit, true otherwise
+ */
+bool setVisitAllStringPrefixes(const Set *set, const char *string, SetVisitor visit, void *context);
+
+/**
+ * @brief Call visit on every key of the set, in an order that depends on the
+ *        implementation.
+ *
+ * @param set          A pointer to a set
+ * @param visit        The function called for each key
+ * @param context      Passed as is to visit
+ * @return bool        false if the visit was stopped by visit or could not be
+ *                     completed (allocation error), true otherwise
+ */
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context);
+
+/**
+ * @brief Write the set to a snapshot file (see Snapshot.h) that setOpen can
+ *        open again without reading a lexicon.
+ *
+ * @param set          A pointer to a set
+ * @param filename     The name of the file to create
+ * @return bool        false in case of error
+ */
+bool setSave(const Set *set, const char *filename);
+
+/**
+ * @brief Open a snapshot written by setSave with the same implementation of
+ *        the set. The open addressing hash table, the sorted array, the
+ *        double-array trie, the radix trie and the DAWG are used directly
+ *        from the mapped file, once every index and size it holds has been
+ *        checked against the sections, and the file is then only copied in
+ *        memory if a new key is inserted. The other implementations (chained and concurrent
+ *        hash tables, BST) are made of pointers, so they are rebuilt from
+ *        the keys of the snapshot. The returned set needs to be freed with
+ *        setFree.
+ *
+ * @param filename     The name of a snapshot file
+ * @return Set*        a pointer to the set, or NULL if the file cannot be opened,
+ *                     was not written by this implementation or is corrupted
+ */
+Set *setOpen(const char *filename);
+
+/**
+ * @brief Create a cursor positioned on the empty string. The set must not be
+ *        modified while the cursor is in use. The returned cursor needs to be
+ *        freed with setCursorFree.
+ *
+ * @param set          A pointer to a set
+ * @return SetCursor*  A pointer to a cursor, or NULL in case of allocation error
+ */
+SetCursor *setCursorCreate(const Set *set);
+
+/**
+ * @brief Free the cursor.
+ *
+ * @param cursor       A pointer to a cursor
+ */
+void setCursorFree(SetCursor *cursor);
+
+/**
+ * @brief Move the cursor back to the empty string.
+ *
+ * @param cursor       A pointer to a cursor
+ */
+void setCursorReset(SetCursor *cursor);
+
+/**
+ * @brief Append a character to the string read by the cursor.
+ *
+ * @param cursor       A pointer to a cursor
+ * @param c            A character (different from \0)
+ * @return int         A combination of SET_CURSOR_KEY and SET_CURSOR_PREFIX.
+ *                     SET_CURSOR_PREFIX may be reported when the set cannot rule
+ *                     it out, but is never missing for an actual prefix.
+ *                     0 means that no key starts with the string read so far:
+ *                     every further step returns 0 until the cursor is reset.
+ */
+int setCursorStep(SetCursor *cursor, char c);
+
+#endif // !_SET_H_
@@ -1,5 +1,9 @@
 /* ========================================================================= *
  * BST definition
+ *
+ * The tree is kept balanced as an AVL tree: the heights of the two subtrees
+ * of a node differ by at most one, so that its depth stays logarithmic
+ * whatever the order in which the keys are inserted.
  * ========================================================================= */
 
 #include <stdio.h>
@@ -10,6 +14,8 @@
 
 #include "List.h"
 #include "Set.h"
+#include "Snapshot.h"
+#include "SortedKeys.h"
 
 /* Opaque Structure */
 typedef struct BNode_t BNode;
@@ -20,12 +26,15 @@ struct BNode_t
     BNode *left;
     BNode *right;
     char *key;
+    int height; // number of nodes on the longest path down to a leaf
 };
 
 struct Set_t
 {
     BNode *root;
     size_t size;
+    size_t maxKeyLength;
+    size_t keyBytes; // memory used by the keys
 };
 
 typedef struct Pair_t
@@ -39,6 +48,10 @@ typedef struct Pair_t
 static void bstFreeRec(BNode *n);
 static BNode *bnNew(const char *key);
 static char *duplicate_string(const char *str);
+static int height(const BNode *n);
+static void updateHeight(BNode *n);
+static BNode *rotate(Set *bst, BNode *n, bool left);
+static void rebalance(Set *bst, BNode *n);
 
 
 /* static functions */
@@ -57,9 +70,11 @@ static BNode *bnNew(const char *key)
         printf("bnNew: allocation error\n");
         return NULL;
     }
+    n->parent = NULL;
     n->left = NULL;
     n->right = NULL;
     n->key = duplicate_string(key);
+    n->height = 1;
     return n;
 }
 
@@ -93,6 +108,107 @@ static char *duplicate_string(const char *str)
     return copy;
 }
 
+/**
+ * @brief Returns the height of a subtree
+ *
+ * @param n the root of the subtree, possibly NULL
+ * @return int
+ */
+static int height(const BNode *n)
+{
+    return n ? n->height : 0;
+}
+
+/**
+ * @brief Computes the height of a node from the heights of its children
+ *
+ * @param n a node
+ */
+static void updateHeight(BNode *n)
+{
+    int left = height(n->left);
+    int right = height(n->right);
+    n->height = 1 + (left > right ? left : right);
+}
+
+/**
+ * @brief Rotates a subtree, its child on the other side taking its place
+ *
+ * @param bst the tree holding the subtree
+ * @param n the root of the subtree
+ * @param left true for a left rotation (the right child goes up), false for
+ *             a right rotation
+ * @return BNode* the new root of the subtree
+ */
+static BNode *rotate(Set *bst, BNode *n, bool left)
+{
+    BNode *up = left ? n->right : n->left;
+    BNode *moved = left ? up->left : up->right;
+
+    // moved changes side: it stays between n and up in key order
+    if (left)
+    {
+        n->right = moved;
+        up->left = n;
+    }
+    else
+    {
+        n->left = moved;
+        up->right = n;
+    }
+    if (moved)
+        moved->parent = n;
+
+    up->parent = n->parent;
+    if (n->parent == NULL)
+        bst->root = up;
+    else if (n->parent->left == n)
+        n->parent->left = up;
+    else
+        n->parent->right = up;
+    n->parent = up;
+
+    updateHeight(n);
+    updateHeight(up);
+    return up;
+}
+
+/**
+ * @brief Restores the balance of the nodes from n up to the root, after a
+ *        node has been added below n
+ *
+ * @param bst the tree
+ * @param n the parent of the added node
+ */
+static void rebalance(Set *bst, BNode *n)
+{
+    while (n != NULL)
+    {
+        int oldHeight = n->height;
+        updateHeight(n);
+        int balance = height(n->left) - height(n->right);
+
+        if (balance > 1)
+        {
+            if (height(n->left->left) < height(n->left->right))
+                rotate(bst, n->left, true);
+            n = rotate(bst, n, false);
+        }
+        else if (balance < -1)
+        {
+            if (height(n->right->right) < height(n->right->left))
+                rotate(bst, n->right, false);
+            n = rotate(bst, n, true);
+        }
+
+        // after an insertion, a rotation restores the previous height of the
+        // subtree: the nodes above are unchanged
+        if (n->height == oldHeight)
+            return;
+        n = n->parent;
+    }
+}
+
 /* header functions */
 
 Set *setCreateEmpty(void)
@@ -105,6 +221,8 @@ Set *setCreateEmpty(void)
     }
     bst->root = NULL;
     bst->size = 0;
+    bst->maxKeyLength = 0;
+    bst->keyBytes = 0;
     return bst;
 }
 
@@ -121,17 +239,29 @@ size_t setNbKeys(const Set *bst)
     return bst->size;
 }
 
+size_t setMemoryUsage(const Set *bst)
+{
+    if (bst == NULL)
+        return 0;
+    return sizeof(Set) + bst->size * sizeof(BNode) + bst->keyBytes;
+}
+
 int setInsert(Set *bst, const char *key)
 {
+    size_t length = strlen(key);
+    if (length > bst->maxKeyLength)
+        bst->maxKeyLength = length;
+
     if (bst->root == NULL)
     {
         bst->root = bnNew(key);
         if (bst->root == NULL)
         {
-            return false;
+            return -1;
         }
         bst->size++;
-        return true;
+        bst->keyBytes += length + 1;
+        return 1;
     }
     BNode *prev = NULL;
     BNode *n = bst->root;
@@ -160,7 +290,9 @@ int setInsert(Set *bst, const char *key)
     {
         prev->right = new;
     }
+    rebalance(bst, prev);
     bst->size++;
+    bst->keyBytes += length + 1;
     return 1;
 }
 
@@ -189,179 +321,108 @@ bool setContains(const Set *bst, const char *key)
 
 /* student code starts here */
 
-#define MINSIZE 1 // minimum size of a word in the lexicon
-
 /* Prototypes of static functions */
 
-static bool isPrefix(const char *str, const char *word);
-static bool fillPrefixes(List *l, const char *str, size_t size, BNode *n, char *wordMin);
-
+static int compareKey(const char *str, size_t length, const char *key);
+static const BNode *prefixRoot(const BNode *n, const char *str, size_t length);
+static const BNode *findPrefixKey(const BNode *top, const char *str, size_t length);
+static bool addPrefixToList(const char *key, size_t length, void *list);
+static bool buildRec(Set *bst, const char **keys, size_t nbKeys, BNode *parent, BNode **root);
+static bool visitRec(const BNode *n, SetVisitor visit, void *context);
+
+/*
+ * The keys starting with a given prefix form a range of the in-order traversal.
+ * The root of the smallest subtree holding that range is the first node met from
+ * the root whose key starts with the prefix. A longer prefix selects a sub-range,
+ * so its root is found by searching down from the root of the shorter prefix.
+ */
 
 /**
- * @brief Checks if a given word is a prefix of a string
+ * @brief Compares the first length characters of a string with a key
  *
- * @param str a string
- * @param word the word to be checked
+ * @param str a string of at least length characters
+ * @param length the number of characters of str to compare
+ * @param key a key
  * 
- * @return bool : true if word is a prefix of str
- *                false otherwise
+ * @return int : < 0, 0 or > 0 as str[0..length[ is less than, equal to or
+ *               greater than key
  */
-static bool isPrefix(const char *str, const char *word){
-
-    return strncmp(str, word, strlen(word)) == 0;
+static int compareKey(const char *str, size_t length, const char *key){
+    int cmp = strncmp(str, key, length);
+    if (cmp == 0 && key[length] != '\0')
+        return -1; // str[0..length[ is a proper prefix of key
+    return cmp;
 }
 
-
 /**
- * @brief Gets the common prefix of 2 strings
+ * @brief Finds the root of the keys starting with a prefix
  *
- * @param str1 a string
- * @param str2 a string
+ * @param n the node to start from (root of a shorter prefix, or the tree root)
+ * @param str a string of at least length characters
+ * @param length the length of the prefix
  * 
- * @return char* the common prefix between str1 and str2
- *                
+ * @return const BNode* : the first node whose key starts with str[0..length[,
+ *                        NULL if there is none
  */
-static char *getCommonPref(const char *str1, const char *str2){
-    size_t size1 = strlen(str1);
-    size_t size2 = strlen(str2);
-
-    char *commonPref = malloc(sizeof(char) * (size1 + 1));
-    if (!commonPref){
-        printf("Allocation Error : Failed to allocate commonPref\n");
-        return NULL;
+static const BNode *prefixRoot(const BNode *n, const char *str, size_t length){
+    while (n != NULL){
+        int cmp = strncmp(n->key, str, length);
+        if (cmp == 0)
+            return n;
+        n = cmp < 0 ? n->right : n->left;
     }
+    return NULL;
+}
 
-    bool match = true;
-    unsigned int j = 0;
-    size_t i = 0;
-    while (i < size1 && i < size2 && match){
-        if (str1[i] == str2[i]){
-            commonPref[j] = str1[i];
-            j++;
-        }
-        else 
-            match = false;
-
-        i++;
+/**
+ * @brief Finds the key equal to a prefix
+ *
+ * @param top the root of the keys starting with the prefix (see prefixRoot)
+ * @param str a string of at least length characters
+ * @param length the length of the prefix
+ * 
+ * @return const BNode* : the node whose key is str[0..length[, NULL if there is none
+ */
+static const BNode *findPrefixKey(const BNode *top, const char *str, size_t length){
+    if (top->key[length] == '\0')
+        return top;
+
+    // top's key is longer than the prefix, which is thus smaller
+    const BNode *n = top->left;
+    while (n != NULL){
+        int cmp = compareKey(str, length, n->key);
+        if (cmp == 0)
+            return n;
+        n = cmp < 0 ? n->left : n->right;
     }
-    commonPref[j] = '\0';
-    return commonPref;
+    return NULL;
 }
 
-
 /**
- * @brief fills recursively a list with found prefixes of a string in the set (bst)
+ * @brief SetVisitor appending a copy of each key to a list
  *
- * @param l  the list to fill
- * @param str the string which prefixes have to be filled
- * @param size size of str
- * @param n the root of the tree
- * @param wordMin the smallest word (smallest prefix possible)
+ * @param key the key found
+ * @param length the length of key
+ * @param list a pointer to a List
  * 
- * @return true if list was filled successfully
- *         false in case of error 
- *               
+ * @return bool : true if the key was added
+ *                false in case of allocation error
  */
-static bool fillPrefixes(List *l, const char *str, size_t size, BNode *n, char *wordMin){
-    if (listSize(l) == size){
-        return true;
+static bool addPrefixToList(const char *key, size_t length, void *list){
+    char *copy = malloc(length + 1);
+    if (!copy){
+        printf("Error : Duplication failed\n"); 
+        return false;
     }
-    if (n != NULL){
+    memcpy(copy, key, length);
+    copy[length] = '\0';
 
-        int cmp1 = strcmp(n->key, wordMin); // compare the node's key with the minimum prefix
-        int cmp2 = strcmp(n->key, str); // compare the node's key with the maximum prefix
-
-        if (isPrefix(str, n->key)){
-          char *copy = duplicate_string(n->key);
-          if (!copy){
-            printf("Error : Duplication failed\n"); 
-            return false;
-          }
-          if (!listInsertLast(l, copy)){
-                printf("Failed to fill prefixes into list\n");
-                free(copy);
-                return false;
-            }
-            
-            if (cmp1 == 0 && cmp2 == 0){ // we only have 1 prefix
-                return true; 
-            }
-
-            else if (cmp1 == 0 || cmp2 == 0){
-                if (cmp1 == 0){ // the minimum (smallest) prefix has been found -> continue search in right sub-tree
-                    return fillPrefixes(l, str, size, n->right, wordMin); 
-                }
-
-                else if (cmp2 == 0) // the maximum (largest) prefix has been found -> continue search in left sub-tree
-                    return fillPrefixes(l, str, size, n->left, wordMin);
-            }
-
-            else { // prefix found is between smallest and largest prefixes -> continue search in both sub-trees
-                unsigned int keySize = strlen(n->key);
-                char nextChar = str[keySize];
-                char *newMin = malloc(sizeof(char) * (keySize + 2));
-                if (!newMin){
-                    printf("Allocation Error : Failed to allocate newMin\n");
-                    return false;
-                }
-                strcpy(newMin, n->key);
-                newMin[keySize] = nextChar;
-                newMin[keySize + 1] = '\0';
-                // newMin is the new minimum prefix for the right subtree
-                if (!fillPrefixes(l, str, size, n->right, newMin)){
-                    free(newMin);
-                    return false;
-                }
-
-                char *newMax = duplicate_string(n->key);
-                if (!newMax){
-                    printf("Error : Failed to duplicate key\n");
-                    free(newMax);
-                    return false;
-                }
-                newMax[keySize-1] = '\0';
-                // newMax is the new maximum prefix for the left subtree
-                if (!fillPrefixes(l, newMax, size, n->left, wordMin)){
-                    free(newMax);
-                    return false;
-                }
-
-                free(newMax);
-                free(newMin);
-            }
-        }
-        
-        // node's key is not a prefix of the word (str)
-        else {
-            if (cmp2 > 0) // node's key is greater than the largest prefix -> continue search in left sub-tree
-                return fillPrefixes(l, str, size,  n->left, wordMin);
-
-            else {
-                if (cmp1 <= 0) // node's key is less than the smallest prefix -> continue search in right sub-tree
-                    return fillPrefixes(l, str, size, n->right, wordMin);
-
-                else if (cmp1 > 0){ // continue search in both sub-tree
-                    char *commonPref = getCommonPref(n->key, str);
-                    if (!commonPref){
-                        printf("Allocation Error : Failed to allocate commonPref\n");
-                        return false;
-                    }
-                    // commonPref is the new minimum prefix for the right sub tree
-                    if (!fillPrefixes(l, str, size, n->right, commonPref)){
-                        free(commonPref);
-                        return false;
-                    }
-                    // commonPref is the new maximum prefix for the right sub tree 
-                    if (!fillPrefixes(l, commonPref, size, n->left, wordMin)){
-                        free(commonPref);
-                        return false;
-                    }
-                    free(commonPref);
-                }
-            }
-        }
+    if (!listInsertLast(list, copy)){
+        printf("Failed to fill prefixes into list\n");
+        free(copy);
+        return false;
     }
-    return true; 
+    return true;
 }
 
 
@@ -373,27 +434,211 @@ List *setGetAllStringPrefixes(const Set *set, const char *str)
     return NULL;
    }
 
-    // Minimum prefix possible of a word with a minimum size of 1 (MINSIZE)
-    char *wordMin = malloc(sizeof(char) * (MINSIZE + 1));
-    if (!wordMin){
-        fprintf(stderr, "Memory allocation failed for minimum prefix\n");
-        return NULL;
-    }
-    strncpy(wordMin, str, MINSIZE);
-    wordMin[MINSIZE] = '\0';
-
-   BNode *n = set->root;
-   size_t strSize = strlen(str);
-
-   // fill prefixes in prefixList
-   if (!fillPrefixes(prefixList, str, strSize, n, wordMin)){
+   if (!setVisitAllStringPrefixes(set, str, addPrefixToList, prefixList)){
     listFree(prefixList, true);
     printf("Error : Failed to fill prefixes in the list\n");
-    free(wordMin);
     return NULL;
    }
 
-   free(wordMin);
-
    return prefixList;
-}
\ No newline at end of file
+}
+
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context)
+{
+    const BNode *top = set->root;
+    for (size_t length = 1; str[length - 1] != '\0'; length++){
+        top = prefixRoot(top, str, length);
+        if (top == NULL) // no key starts with str[0..length[
+            return true;
+
+        const BNode *n = findPrefixKey(top, str, length);
+        if (n != NULL && !visit(n->key, length, context))
+            return false;
+    }
+    return true;
+}
+
+
+/* Bulk construction */
+
+/**
+ * @brief Builds a perfectly balanced tree from sorted keys: the middle key is
+ *        the root, the keys before and after it its left and right subtrees
+ *
+ * @param bst the set the tree belongs to, whose counters are updated
+ * @param keys distinct keys in strcmp order
+ * @param nbKeys the number of keys
+ * @param parent the parent of the tree to build
+ * @param root set to the root of the tree, NULL if there is no key
+ *
+ * @return bool, false in case of allocation error
+ */
+static bool buildRec(Set *bst, const char **keys, size_t nbKeys, BNode *parent, BNode **root){
+    *root = NULL;
+    if (nbKeys == 0)
+        return true;
+
+    size_t middle = nbKeys / 2;
+    BNode *n = bnNew(keys[middle]);
+    if (!n)
+        return false;
+    if (!n->key){
+        free(n);
+        return false;
+    }
+    n->parent = parent;
+    *root = n;
+
+    size_t length = strlen(n->key);
+    if (length > bst->maxKeyLength)
+        bst->maxKeyLength = length;
+    bst->size++;
+    bst->keyBytes += length + 1;
+
+    if (!buildRec(bst, keys, middle, n, &n->left) ||
+        !buildRec(bst, keys + middle + 1, nbKeys - middle - 1, n, &n->right))
+        return false;
+    updateHeight(n);
+    return true;
+}
+
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys){
+    size_t nbSorted;
+    const char **sorted = sortedKeys(keys, nbKeys, &nbSorted);
+    if (!sorted)
+        return NULL;
+
+    Set *bst = setCreateEmpty();
+    if (bst && !buildRec(bst, sorted, nbSorted, NULL, &bst->root)){
+        setFree(bst);
+        bst = NULL;
+    }
+
+    free(sorted);
+    return bst;
+}
+
+
+/* Keys */
+
+/**
+ * @brief Calls visit on the keys of a subtree, in order
+ *
+ * @param n a node
+ * @param visit the function called for each key
+ * @param context passed as is to visit
+ *
+ * @return bool, false if the visit was stopped
+ */
+static bool visitRec(const BNode *n, SetVisitor visit, void *context){
+    if (!n)
+        return true;
+    return visitRec(n->left, visit, context) && visit(n->key, strlen(n->key), context) &&
+           visitRec(n->right, visit, context);
+}
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context){
+    return visitRec(set->root, visit, context);
+}
+
+
+/* Snapshot */
+
+bool setSave(const Set *set, const char *filename){
+    SnapshotKeys keys = {NULL, 0, 0};
+    bool ok = setVisitAllKeys(set, snapshotKeysAdd, &keys);
+
+    SnapshotSection section = {keys.data, keys.size};
+    ok = ok && snapshotWrite(filename, "BST", &section, 1);
+    free(keys.data);
+    return ok;
+}
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "BST");
+    if (!snapshot)
+        return NULL;
+
+    // nodes hold pointers: the tree is rebuilt, balanced, from the sorted keys
+    // of the snapshot
+    size_t nbKeys;
+    const char **keys = snapshotKeys(snapshot, &nbKeys);
+    Set *set = keys ? setBuildFromSorted(keys, nbKeys) : NULL;
+
+    free(keys);
+    snapshotClose(snapshot);
+    return set;
+}
+
+/* Cursor */
+
+struct SetCursor_t
+{
+    const Set *set;
+    const BNode *top; // root of the keys starting with buffer
+    char *buffer; // string read so far, of at most maxKeyLength characters
+    size_t length;
+};
+
+SetCursor *setCursorCreate(const Set *set)
+{
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->buffer = malloc(set->maxKeyLength + 1);
+    if (!cursor->buffer){
+        free(cursor);
+        return NULL;
+    }
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}
+
+void setCursorFree(SetCursor *cursor)
+{
+    if (!cursor)
+        return;
+    free(cursor->buffer);
+    free(cursor);
+}
+
+void setCursorReset(SetCursor *cursor)
+{
+    cursor->top = cursor->set->root;
+    cursor->buffer[0] = '\0';
+    cursor->length = 0;
+}
+
+int setCursorStep(SetCursor *cursor, char c)
+{
+    if (cursor->top == NULL || cursor->length == cursor->set->maxKeyLength){
+        cursor->top = NULL;
+        return 0;
+    }
+
+    cursor->buffer[cursor->length++] = c;
+    cursor->buffer[cursor->length] = '\0';
+
+    const char *str = cursor->buffer;
+    size_t length = cursor->length;
+
+    const BNode *n = prefixRoot(cursor->top, str, length);
+    cursor->top = n;
+    if (n == NULL)
+        return 0;
+
+    if (n->key[length] != '\0')
+        return findPrefixKey(n, str, length) ? SET_CURSOR_KEY | SET_CURSOR_PREFIX : SET_CURSOR_PREFIX;
+
+    // the top key is str itself: a longer key would be its successor
+    const BNode *next = n->right;
+    if (next == NULL)
+        return SET_CURSOR_KEY;
+    while (next->left != NULL)
+        next = next->left;
+    return strncmp(next->key, str, length) == 0 ? SET_CURSOR_KEY | SET_CURSOR_PREFIX : SET_CURSOR_KEY;
+}
@@ -0,0 +1,742 @@
+/* ========================================================================= *
+ * ConcurrentHash
+ *
+ * Implementation of Set.h based on an open-addressing hash table with
+ * linear probing whose slots point to the keys. A slot goes from NULL to its
+ * key once, by compare-and-swap, so that several threads may insert at the
+ * same time, and lookups never take a lock: they only follow pointers that
+ * were complete before being published.
+ *
+ * Inserting threads share a read-write lock in read mode. The thread that
+ * finds the table too full takes it in write mode to move the keys to a table
+ * twice as large; the old table is kept until setFree, since lookups may still
+ * be reading it. setBuildFromSorted splits the keys among one thread per
+ * processor.
+ *
+ * Each table also records the hashes of all the proper prefixes of its keys
+ * in a blocked Bloom filter, so that a prefix search stops as soon as the
+ * string read so far cannot be extended into a key. Inserting threads set
+ * their bits with an atomic or before publishing the key, so that a reader
+ * that finds a key also finds its prefixes. The filter never misses the
+ * prefix of a published key but may report a few false ones.
+ *
+ * ========================================================================= */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "Parallel.h"
+#include "Set.h"
+#include "Snapshot.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INIT_CAPACITY 16 // must be a power of 2
+#define HASH_MULTIPLIER 0x100000001b3ULL
+#define KEYS_PER_THREAD 4096 // fewer keys are inserted by fewer threads
+
+#define FILTER_BITS_PER_SLOT 16 // keys have about 1.5 distinct proper prefixes each
+#define FILTER_NB_PROBES 4
+
+/* Structures */
+
+typedef struct Key_t
+{
+    uint64_t hash;   // rolling hash of the key (see hashStep)
+    size_t length;   // length of the key, at least 1
+    char key[];      // followed by a \0
+} Key;
+
+typedef struct Table_t
+{
+    Key **slots;            // NULL for an empty slot
+    size_t capacity;        // number of slots, a power of 2
+    uint64_t *filter;       // prefix filter of the keys, of filterSize(capacity) words
+    struct Table_t *older;  // the table replaced by this one, NULL if none
+} Table;
+
+struct Set_t
+{
+    Table *table;           // current table, read and written atomically
+    pthread_rwlock_t lock;  // held in read mode to insert, in write mode to grow
+    size_t numElements;     // the counters are updated atomically
+    size_t maxKeyLength;
+    size_t keySize;         // memory used by the keys
+    int hasEmptyKey;        // "" cannot be stored in a slot
+};
+
+typedef struct Loader_t
+{
+    Set *set;
+    const char *const *keys; // the keys inserted by the thread
+    size_t nbKeys;
+    bool ok;
+} Loader;
+
+/* Prototypes */
+
+static uint64_t hashStep(uint64_t hash, char c);
+static uint64_t hashKey(const char *key, size_t *length);
+static uint64_t mixHash(uint64_t hash);
+static size_t slotIndex(const Table *table, uint64_t hash);
+static size_t filterSize(size_t capacity);
+static uint64_t filterBits(uint64_t hash, size_t nbWords, size_t *word);
+static bool filterContains(const Table *table, uint64_t hash);
+static void filterAddPrefixes(Table *table, const char *key, size_t length);
+static const Key *findKey(const Set *set, const char *key, size_t length, uint64_t hash);
+static Table *createTable(size_t capacity);
+static bool growTable(Set *set, const Table *full);
+static void updateMax(size_t *max, size_t value);
+static bool addPrefixToList(const char *key, size_t length, void *list);
+static Set *createWithSize(size_t capacity);
+static void *loadKeys(void *loader);
+
+/* static functions */
+
+/**
+ * @brief Extends a hash by one character. The hash of a string is obtained by
+ *        starting from 0 and adding its characters one at a time, so that the
+ *        hashes of all the prefixes of a string are computed in a single pass.
+ *
+ * @param hash     The hash of a string
+ * @param c        The next character
+ * @return uint64_t The hash of the string followed by c
+ */
+static uint64_t hashStep(uint64_t hash, char c)
+{
+    return hash * HASH_MULTIPLIER + (unsigned char)c;
+}
+
+/**
+ * @brief Compute the hash and the length of a key
+ *
+ * @param key      The key
+ * @param length   Set to the length of the key
+ * @return uint64_t The hash of the key
+ */
+static uint64_t hashKey(const char *key, size_t *length)
+{
+    uint64_t hash = 0;
+    size_t i = 0;
+    for (; key[i] != '\0'; i++)
+        hash = hashStep(hash, key[i]);
+    *length = i;
+    return hash;
+}
+
+/**
+ * @brief Mix the bits of a rolling hash. Its low bits only depend on the low
+ *        bits of the characters, so they are mixed with the high bits before
+ *        being used as an index.
+ *
+ * @param hash      The hash of a string
+ * @return uint64_t
+ */
+static uint64_t mixHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Return the first slot to probe for a hash
+ *
+ * @param table    A pointer to a table
+ * @param hash     The hash of a key
+ * @return size_t  An index in the table
+ */
+static size_t slotIndex(const Table *table, uint64_t hash)
+{
+    return (size_t)mixHash(hash) & (table->capacity - 1);
+}
+
+/**
+ * @brief Return the number of 64-bit words of the prefix filter of a table
+ *
+ * @param capacity  The number of slots, a power of 2 of at least 4
+ * @return size_t   A power of 2
+ */
+static size_t filterSize(size_t capacity)
+{
+    return capacity * FILTER_BITS_PER_SLOT / 64;
+}
+
+/**
+ * @brief Set the word index and the FILTER_NB_PROBES bits of a hash in a filter.
+ *        The index uses the low bits of the mixed hash, the probes the high ones.
+ *
+ * @param hash      The hash of a prefix
+ * @param nbWords   The size of the filter, a power of 2
+ * @param word      Set to the index of the word holding the bits
+ * @return uint64_t The bits
+ */
+static uint64_t filterBits(uint64_t hash, size_t nbWords, size_t *word)
+{
+    hash = mixHash(hash);
+    *word = (size_t)hash & (nbWords - 1);
+
+    uint64_t bits = 0;
+    for (int i = 0; i < FILTER_NB_PROBES; i++)
+        bits |= (uint64_t)1 << ((hash >> (64 - 6 * (i + 1))) & 63);
+    return bits;
+}
+
+/**
+ * @brief Return false if no key of a table can start with the string of the
+ *        given hash followed by at least one character.
+ *
+ * @param table    A pointer to a table
+ * @param hash     The hash of a string
+ * @return bool
+ */
+static bool filterContains(const Table *table, uint64_t hash)
+{
+    size_t word;
+    uint64_t bits = filterBits(hash, filterSize(table->capacity), &word);
+    return (__atomic_load_n(&table->filter[word], __ATOMIC_RELAXED) & bits) == bits;
+}
+
+/**
+ * @brief Add the hashes of the proper prefixes of a key to the filter of a
+ *        table. Several threads may add to the same filter at once.
+ *
+ * @param table    A pointer to a table
+ * @param key      The key
+ * @param length   The length of the key
+ */
+static void filterAddPrefixes(Table *table, const char *key, size_t length)
+{
+    size_t nbWords = filterSize(table->capacity);
+    uint64_t hash = 0;
+    for (size_t i = 0; i + 1 < length; i++)
+    {
+        hash = hashStep(hash, key[i]);
+        size_t word;
+        uint64_t bits = filterBits(hash, nbWords, &word);
+        // most words already hold the bits: skip the write, and the cache line transfer
+        if ((__atomic_load_n(&table->filter[word], __ATOMIC_RELAXED) & bits) != bits)
+            __atomic_fetch_or(&table->filter[word], bits, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Find a key without taking the lock. A key inserted meanwhile by
+ *        another thread may or may not be found.
+ *
+ * @param set      A pointer to a set
+ * @param key      The key (not necessarily followed by a \0)
+ * @param length   The length of the key, at least 1
+ * @param hash     The hash of the key
+ * @return const Key* The key found, NULL if there is none
+ */
+static const Key *findKey(const Set *set, const char *key, size_t length, uint64_t hash)
+{
+    // the acquire loads see the keys as they were written before being published
+    const Table *table = __atomic_load_n(&set->table, __ATOMIC_ACQUIRE);
+    size_t mask = table->capacity - 1;
+    size_t index = slotIndex(table, hash);
+
+    // the table is never full: the probe ends on an empty slot
+    for (size_t probes = 0; probes < table->capacity; probes++)
+    {
+        const Key *slot = __atomic_load_n(&table->slots[index], __ATOMIC_ACQUIRE);
+        if (!slot)
+            return NULL;
+        if (slot->hash == hash && slot->length == length && memcmp(slot->key, key, length) == 0)
+            return slot;
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Create a table of empty slots, with an empty filter
+ *
+ * @param capacity The number of slots, a power of 2
+ * @return Table*  A pointer to the table, NULL in case of allocation error
+ */
+static Table *createTable(size_t capacity)
+{
+    Table *table = malloc(sizeof(Table));
+    if (!table)
+        return NULL;
+
+    table->slots = calloc(capacity, sizeof(Key *));
+    table->filter = calloc(filterSize(capacity), sizeof(uint64_t));
+    if (!table->slots || !table->filter)
+    {
+        free(table->slots);
+        free(table->filter);
+        free(table);
+        return NULL;
+    }
+    table->capacity = capacity;
+    table->older = NULL;
+    return table;
+}
+
+/**
+ * @brief Replace a table by one twice as large, unless another thread already
+ *        did. Must be called without holding the lock.
+ *
+ * @param set      A pointer to a set
+ * @param full     The table found too full
+ * @return bool    false in case of allocation error
+ */
+static bool growTable(Set *set, const Table *full)
+{
+    pthread_rwlock_wrlock(&set->lock);
+
+    // no insertion runs now: the slots can be read without atomics
+    Table *old = set->table;
+    if (old != full)
+    {
+        pthread_rwlock_unlock(&set->lock);
+        return true;
+    }
+
+    Table *table = createTable(2 * old->capacity);
+    if (!table)
+    {
+        pthread_rwlock_unlock(&set->lock);
+        return false;
+    }
+
+    // keys are moved using their stored hash, but the larger filter is
+    // refilled from the keys
+    size_t mask = table->capacity - 1;
+    for (size_t i = 0; i < old->capacity; i++)
+    {
+        if (!old->slots[i])
+            continue;
+
+        size_t index = slotIndex(table, old->slots[i]->hash);
+        while (table->slots[index])
+            index = (index + 1) & mask;
+        table->slots[index] = old->slots[i];
+        filterAddPrefixes(table, old->slots[i]->key, old->slots[i]->length);
+    }
+
+    table->older = old;
+    __atomic_store_n(&set->table, table, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&set->lock);
+    return true;
+}
+
+/**
+ * @brief Atomically raise a counter to a value
+ *
+ * @param max      A pointer to the counter
+ * @param value    The new value, kept if greater than the counter
+ */
+static void updateMax(size_t *max, size_t value)
+{
+    size_t current = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (value > current &&
+           !__atomic_compare_exchange_n(max, &current, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/**
+ * @brief SetVisitor appending a copy of each key to a list
+ *
+ * @param key      The key found
+ * @param length   The length of key
+ * @param list     A pointer to a List
+ * @return bool    false in case of allocation error
+ */
+static bool addPrefixToList(const char *key, size_t length, void *list)
+{
+    char *copy = malloc(length + 1);
+    if (!copy)
+        return false;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+
+    if (!listInsertLast(list, copy))
+    {
+        free(copy);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Create an empty set with the given number of slots
+ *
+ * @param capacity The number of slots, a power of 2
+ * @return Set*    A pointer to the set, NULL in case of allocation error
+ */
+static Set *createWithSize(size_t capacity)
+{
+    Set *res = malloc(sizeof(Set));
+    if (!res)
+        return NULL;
+
+    res->table = createTable(capacity);
+    if (!res->table || pthread_rwlock_init(&res->lock, NULL) != 0)
+    {
+        if (res->table)
+        {
+            free(res->table->slots);
+            free(res->table->filter);
+        }
+        free(res->table);
+        free(res);
+        return NULL;
+    }
+
+    res->numElements = 0;
+    res->maxKeyLength = 0;
+    res->keySize = 0;
+    res->hasEmptyKey = 0;
+    return res;
+}
+
+/**
+ * @brief Thread inserting its share of the keys of setBuildFromSorted
+ *
+ * @param loader   A pointer to a Loader
+ * @return void*   NULL
+ */
+static void *loadKeys(void *loader)
+{
+    Loader *load = loader;
+    load->ok = true;
+    for (size_t i = 0; load->ok && i < load->nbKeys; i++)
+        load->ok = setInsert(load->set, load->keys[i]) >= 0;
+    return NULL;
+}
+
+/* header functions */
+
+Set *setCreateEmpty(void)
+{
+    return createWithSize(INIT_CAPACITY);
+}
+
+void setFree(Set *set)
+{
+    if (!set)
+        return;
+
+    Table *table = set->table;
+    for (size_t i = 0; i < table->capacity; i++)
+        free(table->slots[i]);
+
+    while (table)
+    {
+        Table *older = table->older;
+        free(table->slots);
+        free(table->filter);
+        free(table);
+        table = older;
+    }
+
+    pthread_rwlock_destroy(&set->lock);
+    free(set);
+}
+
+size_t setNbKeys(const Set *set)
+{
+    if (!set)
+        return (size_t)-1;
+    return __atomic_load_n(&set->numElements, __ATOMIC_RELAXED);
+}
+
+size_t setMemoryUsage(const Set *set)
+{
+    if (!set)
+        return 0;
+
+    // the older tables are counted too: they are only freed by setFree
+    // with their prefix filters: 1 MiB of the 8 MiB used for english.txt
+    size_t size = sizeof(Set) + __atomic_load_n(&set->keySize, __ATOMIC_RELAXED);
+    for (const Table *table = __atomic_load_n(&set->table, __ATOMIC_ACQUIRE); table; table = table->older)
+        size += sizeof(Table) + table->capacity * sizeof(Key *) + filterSize(table->capacity) * sizeof(uint64_t);
+    return size;
+}
+
+bool setContains(const Set *set, const char *key)
+{
+    if (!set)
+        return false;
+
+    if (key[0] == '\0')
+        return __atomic_load_n(&set->hasEmptyKey, __ATOMIC_ACQUIRE);
+
+    size_t length;
+    uint64_t hash = hashKey(key, &length);
+    return findKey(set, key, length, hash) != NULL;
+}
+
+int setInsert(Set *set, const char *key)
+{
+    if (!set)
+        return -1;
+
+    if (key[0] == '\0')
+    {
+        int expected = 0;
+        if (!__atomic_compare_exchange_n(&set->hasEmptyKey, &expected, 1, false, __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE))
+            return 0;
+        __atomic_fetch_add(&set->numElements, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    size_t length;
+    uint64_t hash = hashKey(key, &length);
+    if (findKey(set, key, length, hash))
+        return 0;
+
+    // the copy is complete before being published
+    Key *record = malloc(sizeof(Key) + length + 1);
+    if (!record)
+        return -1;
+    record->hash = hash;
+    record->length = length;
+    memcpy(record->key, key, length + 1);
+
+    for (;;)
+    {
+        pthread_rwlock_rdlock(&set->lock);
+        Table *table = set->table;
+
+        // the prefixes are recorded before the key is published; a table that
+        // grows meanwhile gets them from the key once it is published
+        filterAddPrefixes(table, key, length);
+
+        // keep the load factor below 3/4; several threads may pass the test at
+        // once, so the probe below still stops once it went round the table
+        bool full = 4 * (__atomic_load_n(&set->numElements, __ATOMIC_RELAXED) + 1) > 3 * table->capacity;
+        size_t mask = table->capacity - 1;
+        size_t index = slotIndex(table, hash);
+        for (size_t probes = 0; !full && probes < table->capacity; probes++)
+        {
+            Key *expected = NULL;
+            if (__atomic_compare_exchange_n(&table->slots[index], &expected, record, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+            {
+                pthread_rwlock_unlock(&set->lock);
+                __atomic_fetch_add(&set->numElements, 1, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&set->keySize, sizeof(Key) + length + 1, __ATOMIC_RELAXED);
+                updateMax(&set->maxKeyLength, length);
+                return 1;
+            }
+
+            // the slot is taken, possibly by the same key inserted meanwhile
+            if (expected->hash == hash && expected->length == length &&
+                memcmp(expected->key, key, length) == 0)
+            {
+                pthread_rwlock_unlock(&set->lock);
+                free(record);
+                return 0;
+            }
+            index = (index + 1) & mask;
+        }
+
+        pthread_rwlock_unlock(&set->lock);
+        if (!growTable(set, table))
+        {
+            free(record);
+            return -1;
+        }
+    }
+}
+
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys)
+{
+    // the order of the keys does not matter here: the table is allocated at its
+    // final size, so that the threads never wait for it to grow
+    size_t capacity = INIT_CAPACITY;
+    while (4 * nbKeys > 3 * capacity)
+        capacity *= 2;
+
+    Set *set = createWithSize(capacity);
+    if (!set)
+        return NULL;
+
+    size_t nbThreads = parallelNbThreads(0);
+    if (nbKeys / KEYS_PER_THREAD < nbThreads)
+        nbThreads = nbKeys / KEYS_PER_THREAD;
+    if (nbThreads == 0)
+        nbThreads = 1;
+
+    Loader *loaders = malloc(nbThreads * sizeof(Loader));
+    if (!loaders)
+    {
+        setFree(set);
+        return NULL;
+    }
+
+    for (size_t t = 0; t < nbThreads; t++)
+    {
+        size_t begin = nbKeys * t / nbThreads, end = nbKeys * (t + 1) / nbThreads;
+        loaders[t] = (Loader){set, keys + begin, end - begin, true};
+    }
+    parallelRun(loadKeys, loaders, sizeof(Loader), nbThreads);
+
+    bool ok = true;
+    for (size_t t = 0; t < nbThreads; t++)
+        ok = ok && loaders[t].ok;
+
+    free(loaders);
+    if (!ok)
+    {
+        setFree(set);
+        return NULL;
+    }
+    return set;
+}
+
+List *setGetAllStringPrefixes(const Set *set, const char *str)
+{
+    List *foundPrefixes = listNew();
+    if (!foundPrefixes)
+        return NULL;
+
+    if (!setVisitAllStringPrefixes(set, str, addPrefixToList, foundPrefixes))
+    {
+        listFree(foundPrefixes, true);
+        return NULL;
+    }
+    return foundPrefixes;
+}
+
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context)
+{
+    uint64_t hash = 0;
+    // no key is longer than maxKeyLength
+    size_t maxKeyLength = __atomic_load_n(&set->maxKeyLength, __ATOMIC_RELAXED);
+    for (size_t i = 0; str[i] != '\0' && i < maxKeyLength; i++)
+    {
+        hash = hashStep(hash, str[i]);
+
+        const Key *found = findKey(set, str, i + 1, hash);
+        if (found && !visit(found->key, i + 1, context))
+            return false;
+
+        if (!filterContains(__atomic_load_n(&set->table, __ATOMIC_ACQUIRE), hash)) // no key starts with str[0..i]
+            break;
+    }
+    return true;
+}
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context)
+{
+    // the keys come in the order of the table
+    if (__atomic_load_n(&set->hasEmptyKey, __ATOMIC_ACQUIRE) && !visit("", 0, context))
+        return false;
+
+    const Table *table = __atomic_load_n(&set->table, __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        const Key *slot = __atomic_load_n(&table->slots[i], __ATOMIC_ACQUIRE);
+        if (slot && !visit(slot->key, slot->length, context))
+            return false;
+    }
+    return true;
+}
+
+/* Snapshot */
+
+bool setSave(const Set *set, const char *filename)
+{
+    // the slots hold addresses: only the keys are saved
+    SnapshotKeys keys = {NULL, 0, 0};
+    bool ok = setVisitAllKeys(set, snapshotKeysAdd, &keys);
+
+    SnapshotSection section = {keys.data, keys.size};
+    ok = ok && snapshotWrite(filename, "ConcurrentHash", &section, 1);
+    free(keys.data);
+    return ok;
+}
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "ConcurrentHash");
+    if (!snapshot)
+        return NULL;
+
+    // slots point to their own copy of the keys: the table is rebuilt from the
+    // snapshot, by all the processors
+    size_t nbKeys;
+    const char **keys = snapshotKeys(snapshot, &nbKeys);
+    Set *set = keys ? setBuildFromSorted(keys, nbKeys) : NULL;
+
+    free(keys);
+    snapshotClose(snapshot);
+    return set;
+}
+
+/* Cursor */
+
+struct SetCursor_t
+{
+    const Set *set;
+    char *buffer;        // string read so far, of at most maxKeyLength characters
+    size_t length;
+    size_t maxKeyLength; // that of the set when the cursor was created
+    uint64_t hash;       // hash of buffer
+    bool dead;
+};
+
+SetCursor *setCursorCreate(const Set *set)
+{
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->maxKeyLength = __atomic_load_n(&set->maxKeyLength, __ATOMIC_RELAXED);
+    cursor->buffer = malloc(cursor->maxKeyLength + 1);
+    if (!cursor->buffer)
+    {
+        free(cursor);
+        return NULL;
+    }
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}
+
+void setCursorFree(SetCursor *cursor)
+{
+    if (!cursor)
+        return;
+    free(cursor->buffer);
+    free(cursor);
+}
+
+void setCursorReset(SetCursor *cursor)
+{
+    cursor->length = 0;
+    cursor->hash = 0;
+    cursor->dead = false;
+}
+
+int setCursorStep(SetCursor *cursor, char c)
+{
+    if (cursor->dead || cursor->length == cursor->maxKeyLength)
+    {
+        cursor->dead = true;
+        return 0;
+    }
+
+    cursor->buffer[cursor->length++] = c;
+    cursor->hash = hashStep(cursor->hash, c);
+
+    int flags = 0;
+    if (cursor->length < cursor->maxKeyLength &&
+        filterContains(__atomic_load_n(&cursor->set->table, __ATOMIC_ACQUIRE), cursor->hash))
+        flags |= SET_CURSOR_PREFIX;
+    if (findKey(cursor->set, cursor->buffer, cursor->length, cursor->hash))
+        flags |= SET_CURSOR_KEY;
+
+    cursor->dead = (flags == 0);
+    return flags;
+}
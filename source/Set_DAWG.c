@@ -0,0 +1,1254 @@
+/* ========================================================================= *
+ * DAWG
+ *
+ * Implementation of Set.h based on a minimal acyclic automaton (directed
+ * acyclic word graph): words sharing a suffix share the states reading it.
+ *
+ * Minimality is kept after every insertion. All states but the start state
+ * are hash-consed in a register keyed by their finality and transitions, so
+ * two states with the same right language are always the same state. An
+ * insertion rewrites the states on the path of the new word from the bottom
+ * up: a state only reachable through that path is modified in place, while a
+ * state from the first confluence state (one with several incoming
+ * transitions) onwards is cloned, as in Daciuk et al. Each rewritten state is
+ * then replaced by its equivalent from the register, or registered, and
+ * states left without incoming transitions are freed.
+ *
+ * Keys can therefore be inserted in any order. setBuildFromSorted uses the
+ * one-pass construction of Daciuk et al. for sorted input instead: only the
+ * path of the last word is kept out of the register, and the states the next
+ * word does not share are replaced or registered before it is added, so no
+ * state is ever cloned.
+ *
+ * A snapshot holds the automaton without any pointer: states are numbered,
+ * and the transitions of all states are kept in a single array. setOpen uses
+ * both arrays from the mapped file, and the first insertion of a new key
+ * builds the states in memory from them.
+ * ========================================================================= */
+
+#include "Set.h"
+#include "Snapshot.h"
+#include "SortedKeys.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INIT_REGISTER_SIZE 1024 // must be a power of 2
+#define NO_STATE UINT32_MAX
+
+/* Structures */
+
+typedef struct State_t State;
+typedef struct FlatState_t FlatState;
+typedef struct FlatTransition_t FlatTransition;
+
+/*
+ * The transitions of a state are kept in a single block: the targets,
+ * followed by their labels (see stateLabels), sorted by label. A transition
+ * thus takes 9 bytes rather than the 16 of a padded structure. The hash of a
+ * registered state is not kept: registered states are never modified, so it
+ * is computed again when needed.
+ */
+struct State_t
+{
+    State **targets;  // nbTransitions targets then nbTransitions labels, NULL if there is none
+    State *next;      // next state in the same register bucket
+    uint32_t refs;    // number of incoming transitions (+1 for the start state)
+    uint16_t nbTransitions;
+    bool final;
+    bool registered;
+};
+
+#define TRANSITION_SIZE (sizeof(State *) + 1) // a target and its label
+
+struct Set_t
+{
+    State *start;    // NULL if the automaton is mapped
+    size_t numKeys;
+    State **buckets; // the register
+    size_t nbBuckets; // a power of 2
+    size_t nbStates;
+    size_t nbTransitions;
+    size_t maxKeyLength;
+    const FlatState *flatStates; // the automaton if it is mapped, NULL otherwise
+    const FlatTransition *flatTransitions;
+    Snapshot *snapshot; // the file holding them if they are mapped, NULL otherwise
+};
+
+/* Layout of the snapshot files */
+
+#define SECTION_HEADER 1
+#define SECTION_STATES 2
+#define SECTION_TRANSITIONS 3
+
+typedef struct SnapshotHeader_t
+{
+    uint64_t numKeys;
+    uint64_t nbStates;
+    uint64_t nbTransitions;
+    uint64_t maxKeyLength;
+} SnapshotHeader;
+
+/*
+ * States are numbered in breadth-first order from the start state, which is
+ * state 0. The transitions of a state follow those of the state before it.
+ */
+struct FlatState_t
+{
+    uint32_t firstTransition; // index of the first transition of the state
+    uint16_t nbTransitions;
+    uint16_t final;
+};
+
+struct FlatTransition_t
+{
+    uint32_t target; // number of the target state
+    char label;
+};
+
+/* Prototypes */
+
+static char *stateLabels(const State *state);
+static State *stateNew(Set *set, bool final);
+static State *stateClone(Set *set, const State *state);
+static void stateRelease(Set *set, State *state);
+static const State *stateNext(const State *state, char c);
+static int findTransition(const State *state, char c);
+static bool setTransition(Set *set, State *state, char c, State *target);
+
+static uint64_t stateHash(const State *state);
+static bool stateEquals(const State *a, const State *b);
+static bool registerGrow(Set *set);
+static void registerRemove(Set *set, State *state);
+static void registerAdd(Set *set, State *state, uint64_t hash);
+static State *replaceOrRegister(Set *set, State *state);
+static State *addSuffix(Set *set, const char *suffix);
+static bool freezePath(Set *set, State **path, size_t length, size_t prefixLength);
+
+static uint32_t flatNext(const Set *set, uint32_t state, char c);
+static bool flatten(const Set *set, FlatState **states, FlatTransition **transitions, SnapshotHeader *header);
+static bool detach(Set *set);
+static bool checkSnapshot(const SnapshotHeader *header, const FlatState *states, const FlatTransition *transitions);
+
+static bool visitRec(const State *state, char *path, size_t length, SetVisitor visit, void *context);
+static bool flatVisitRec(const Set *set, uint32_t state, char *path, size_t length, SetVisitor visit, void *context);
+static bool addPrefixToList(const char *key, size_t length, void *list);
+
+/* static functions */
+
+/**
+ * @brief Return the labels of the transitions of a state, which follow their
+ *        targets in the same block
+ *
+ * @param state    A state
+ * @return char*   The nbTransitions labels, sorted
+ */
+static char *stateLabels(const State *state)
+{
+    return (char *)(state->targets + state->nbTransitions);
+}
+
+/**
+ * @brief Create a state without transitions
+ *
+ * @param set      A pointer to a set
+ * @param final    Whether the state accepts
+ * @return State*  The new state, NULL in case of allocation error
+ */
+static State *stateNew(Set *set, bool final)
+{
+    State *state = malloc(sizeof(State));
+    if (!state)
+        return NULL;
+    set->nbStates++;
+
+    state->targets = NULL;
+    state->next = NULL;
+    state->refs = 0;
+    state->nbTransitions = 0;
+    state->final = final;
+    state->registered = false;
+    return state;
+}
+
+/**
+ * @brief Create an unregistered copy of a state, with the same transitions
+ *
+ * @param set      A pointer to a set
+ * @param state    A state
+ * @return State*  The copy, NULL in case of allocation error
+ */
+static State *stateClone(Set *set, const State *state)
+{
+    State *clone = stateNew(set, state->final);
+    if (!clone)
+        return NULL;
+
+    if (state->nbTransitions > 0)
+    {
+        clone->targets = malloc(state->nbTransitions * TRANSITION_SIZE);
+        if (!clone->targets)
+        {
+            stateRelease(set, clone);
+            return NULL;
+        }
+        memcpy(clone->targets, state->targets, state->nbTransitions * TRANSITION_SIZE);
+        clone->nbTransitions = state->nbTransitions;
+        set->nbTransitions += clone->nbTransitions;
+
+        for (uint16_t i = 0; i < clone->nbTransitions; i++)
+            clone->targets[i]->refs++;
+    }
+    return clone;
+}
+
+/**
+ * @brief Drop a reference to a state, freeing it (and the states only it
+ *        leads to) once nothing leads to it anymore.
+ *
+ * @param set      A pointer to a set
+ * @param state    A state whose reference count is at least 1, or a new
+ *                 state whose reference count is 0
+ */
+static void stateRelease(Set *set, State *state)
+{
+    if (state->refs > 0 && --state->refs > 0)
+        return;
+
+    if (state->registered)
+        registerRemove(set, state);
+
+    for (uint16_t i = 0; i < state->nbTransitions; i++)
+        stateRelease(set, state->targets[i]);
+
+    set->nbStates--;
+    set->nbTransitions -= state->nbTransitions;
+    free(state->targets);
+    free(state);
+}
+
+/**
+ * @brief Find the index of the transition of a state labelled by a character
+ *
+ * @param state    A state
+ * @param c        A character
+ * @return int     The index of the transition, or -1 if there is none
+ */
+static int findTransition(const State *state, char c)
+{
+    const char *labels = stateLabels(state);
+    for (int i = 0; i < state->nbTransitions; i++)
+    {
+        if (labels[i] == c)
+            return i;
+        if ((unsigned char)labels[i] > (unsigned char)c) // sorted
+            return -1;
+    }
+    return -1;
+}
+
+/**
+ * @brief Follow the transition of a state labelled by a character
+ *
+ * @param state    A state
+ * @param c        A character
+ * @return const State* The target of the transition, or NULL if there is none
+ */
+static const State *stateNext(const State *state, char c)
+{
+    int i = findTransition(state, c);
+    return i < 0 ? NULL : state->targets[i];
+}
+
+/**
+ * @brief Make the transition of an unregistered state labelled by c lead to
+ *        target, adding the transition if needed. The previous target is
+ *        released.
+ *
+ * @param set      A pointer to a set
+ * @param state    An unregistered state
+ * @param c        A character
+ * @param target   The new target
+ * @return bool    false in case of allocation error
+ */
+static bool setTransition(Set *set, State *state, char c, State *target)
+{
+    int i = findTransition(state, c);
+    if (i >= 0)
+    {
+        State *old = state->targets[i];
+        if (old != target)
+        {
+            target->refs++;
+            state->targets[i] = target;
+            stateRelease(set, old);
+        }
+        return true;
+    }
+
+    uint16_t n = state->nbTransitions;
+    State **targets = realloc(state->targets, (n + 1) * TRANSITION_SIZE);
+    if (!targets)
+        return false;
+    state->targets = targets;
+
+    // the labels move one target further
+    char *labels = (char *)(targets + n + 1);
+    memmove(labels, targets + n, n);
+
+    i = n;
+    while (i > 0 && (unsigned char)labels[i - 1] > (unsigned char)c)
+    {
+        targets[i] = targets[i - 1];
+        labels[i] = labels[i - 1];
+        i--;
+    }
+    targets[i] = target;
+    labels[i] = c;
+    target->refs++;
+
+    state->nbTransitions++;
+    set->nbTransitions++;
+    return true;
+}
+
+/**
+ * @brief Hash a state on its finality and transitions. The targets are
+ *        registered states, so they are identified by their address.
+ *
+ * @param state    A state
+ * @return uint64_t The hash of the state
+ */
+static uint64_t stateHash(const State *state)
+{
+    const char *labels = stateLabels(state);
+    uint64_t hash = 0xcbf29ce484222325ULL ^ state->final;
+    for (uint16_t i = 0; i < state->nbTransitions; i++)
+    {
+        hash = (hash ^ (unsigned char)labels[i]) * 0x100000001b3ULL;
+        hash = (hash ^ (uintptr_t)state->targets[i]) * 0x100000001b3ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+/**
+ * @brief Check whether two states have the same finality and transitions,
+ *        hence the same right language.
+ *
+ * @param a        A state
+ * @param b        A state
+ * @return bool
+ */
+static bool stateEquals(const State *a, const State *b)
+{
+    // the block holds the targets then the labels, both of the same length
+    return a->final == b->final && a->nbTransitions == b->nbTransitions &&
+           (a->nbTransitions == 0 || memcmp(a->targets, b->targets, a->nbTransitions * TRANSITION_SIZE) == 0);
+}
+
+/**
+ * @brief Double the number of buckets of the register
+ *
+ * @param set      A pointer to a set
+ * @return bool    false in case of allocation error
+ */
+static bool registerGrow(Set *set)
+{
+    size_t nbBuckets = 2 * set->nbBuckets;
+    State **buckets = calloc(nbBuckets, sizeof(State *));
+    if (!buckets)
+        return false;
+
+    for (size_t i = 0; i < set->nbBuckets; i++)
+    {
+        State *state = set->buckets[i];
+        while (state)
+        {
+            State *next = state->next;
+            size_t index = stateHash(state) & (nbBuckets - 1);
+            state->next = buckets[index];
+            buckets[index] = state;
+            state = next;
+        }
+    }
+
+    free(set->buckets);
+    set->buckets = buckets;
+    set->nbBuckets = nbBuckets;
+    return true;
+}
+
+/**
+ * @brief Remove a state from the register
+ *
+ * @param set      A pointer to a set
+ * @param state    A registered state
+ */
+static void registerRemove(Set *set, State *state)
+{
+    State **link = &set->buckets[stateHash(state) & (set->nbBuckets - 1)];
+    while (*link != state)
+        link = &(*link)->next;
+
+    *link = state->next;
+    state->next = NULL;
+    state->registered = false;
+}
+
+/**
+ * @brief Add a state to the register
+ *
+ * @param set      A pointer to a set
+ * @param state    An unregistered state, with no registered equivalent
+ * @param hash     The hash of state
+ */
+static void registerAdd(Set *set, State *state, uint64_t hash)
+{
+    size_t index = hash & (set->nbBuckets - 1);
+    state->next = set->buckets[index];
+    state->registered = true;
+    set->buckets[index] = state;
+}
+
+/**
+ * @brief Return the registered state equivalent to a state, registering the
+ *        state if there is none. An unreferenced state that has an
+ *        equivalent is freed.
+ *
+ * @param set      A pointer to a set
+ * @param state    An unregistered state
+ * @return State*  The registered equivalent of state, NULL in case of
+ *                 allocation error
+ */
+static State *replaceOrRegister(Set *set, State *state)
+{
+    uint64_t hash = stateHash(state);
+
+    for (State *other = set->buckets[hash & (set->nbBuckets - 1)]; other; other = other->next)
+    {
+        if (stateEquals(other, state))
+        {
+            if (state->refs == 0)
+                stateRelease(set, state);
+            return other;
+        }
+    }
+
+    // keep about one state per bucket
+    if (set->nbStates > set->nbBuckets && !registerGrow(set))
+    {
+        if (state->refs == 0)
+            stateRelease(set, state);
+        return NULL;
+    }
+
+    registerAdd(set, state, hash);
+    return state;
+}
+
+/**
+ * @brief Build the registered chain of states reading a suffix and accepting
+ *
+ * @param set      A pointer to a set
+ * @param suffix   A string, possibly empty
+ * @return State*  The registered state reading suffix (not referenced yet),
+ *                 NULL in case of allocation error
+ */
+static State *addSuffix(Set *set, const char *suffix)
+{
+    State *state = stateNew(set, true);
+    if (!state)
+        return NULL;
+    state = replaceOrRegister(set, state);
+
+    for (size_t i = strlen(suffix); state && i-- > 0;)
+    {
+        State *previous = stateNew(set, false);
+        if (!previous)
+        {
+            if (state->refs == 0)
+                stateRelease(set, state);
+            return NULL;
+        }
+
+        if (!setTransition(set, previous, suffix[i], state))
+        {
+            stateRelease(set, previous);
+            if (state->refs == 0)
+                stateRelease(set, state);
+            return NULL;
+        }
+        state = replaceOrRegister(set, previous);
+    }
+    return state;
+}
+
+/**
+ * @brief Replace or register the states of the path of the last word added
+ *        by setBuildFromSorted below a given depth, from the bottom up. A
+ *        state of that path is always the target of the last transition of
+ *        the previous one.
+ *
+ * @param set          A pointer to a set being built
+ * @param path         The states of the path, path[0] being the start state
+ * @param length       The depth of the last state of the path
+ * @param prefixLength The depth of the last state kept out of the register
+ * @return bool        false in case of allocation error
+ */
+static bool freezePath(Set *set, State **path, size_t length, size_t prefixLength)
+{
+    for (size_t i = length; i > prefixLength; i--)
+    {
+        State *state = replaceOrRegister(set, path[i]);
+        if (!state)
+            return false;
+
+        // the equivalent takes the place of the state, which is then freed
+        if (state != path[i])
+        {
+            State *parent = path[i - 1];
+            setTransition(set, parent, stateLabels(parent)[parent->nbTransitions - 1], state);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Follow the transition of a mapped state labelled by a character
+ *
+ * @param set      A pointer to a mapped set
+ * @param state    The number of a state
+ * @param c        A character
+ * @return uint32_t The number of the target, or NO_STATE if there is none
+ */
+static uint32_t flatNext(const Set *set, uint32_t state, char c)
+{
+    const FlatTransition *transitions = set->flatTransitions + set->flatStates[state].firstTransition;
+    for (uint16_t i = 0; i < set->flatStates[state].nbTransitions; i++)
+    {
+        if (transitions[i].label == c)
+            return transitions[i].target;
+        if ((unsigned char)transitions[i].label > (unsigned char)c) // sorted
+            return NO_STATE;
+    }
+    return NO_STATE;
+}
+
+/**
+ * @brief Number the states of an automaton in memory in breadth-first order,
+ *        and write them and their transitions in two arrays, which need to
+ *        be freed by the user. A state met again is found by its address in
+ *        a table with open addressing.
+ *
+ * @param set          A pointer to a set that is not mapped
+ * @param states       Set to the array of states
+ * @param transitions  Set to the array of transitions
+ * @param header       Its nbStates and nbTransitions are set
+ * @return bool        false in case of allocation error, or if there are
+ *                     too many states to number
+ */
+static bool flatten(const Set *set, FlatState **states, FlatTransition **transitions, SnapshotHeader *header)
+{
+    if (set->nbStates >= NO_STATE || set->nbTransitions >= UINT32_MAX)
+        return false;
+
+    size_t nbSlots = 1;
+    while (nbSlots < 2 * set->nbStates)
+        nbSlots *= 2;
+    const State **slots = calloc(nbSlots, sizeof(State *));
+    uint32_t *numbers = malloc(nbSlots * sizeof(uint32_t));
+    const State **order = malloc(set->nbStates * sizeof(State *)); // the states by number
+    *states = malloc(set->nbStates * sizeof(FlatState));
+    // calloc: the padding of the transitions is written too
+    *transitions = calloc(set->nbTransitions + 1, sizeof(FlatTransition));
+    if (!slots || !numbers || !order || !*states || !*transitions)
+    {
+        free(slots);
+        free(numbers);
+        free(order);
+        free(*states);
+        free(*transitions);
+        return false;
+    }
+
+    size_t nbNumbered = 1, nbWritten = 0;
+    order[0] = set->start;
+    for (size_t i = 0; i < nbNumbered; i++)
+    {
+        const State *state = order[i];
+        (*states)[i] = (FlatState){(uint32_t)nbWritten, state->nbTransitions, state->final};
+
+        for (uint16_t j = 0; j < state->nbTransitions; j++)
+        {
+            const State *target = state->targets[j];
+            size_t slot = (size_t)(((uintptr_t)target >> 4) * 0x9e3779b97f4a7c15ULL) & (nbSlots - 1);
+            while (slots[slot] && slots[slot] != target)
+                slot = (slot + 1) & (nbSlots - 1);
+            if (!slots[slot])
+            {
+                slots[slot] = target;
+                numbers[slot] = (uint32_t)nbNumbered;
+                order[nbNumbered++] = target;
+            }
+
+            (*transitions)[nbWritten].target = numbers[slot];
+            (*transitions)[nbWritten++].label = stateLabels(state)[j];
+        }
+    }
+
+    header->nbStates = nbNumbered;
+    header->nbTransitions = nbWritten;
+    free(slots);
+    free(numbers);
+    free(order);
+    return true;
+}
+
+/**
+ * @brief Build in memory the states of a set opened from a snapshot, so that
+ *        it can be modified. The saved automaton is minimal: its states are
+ *        registered as they are.
+ *
+ * @param set      A pointer to a set
+ * @return bool    false in case of allocation error
+ */
+static bool detach(Set *set)
+{
+    if (!set->snapshot)
+        return true;
+
+    size_t nbBuckets = INIT_REGISTER_SIZE;
+    while (nbBuckets < set->nbStates)
+        nbBuckets *= 2;
+    State **states = calloc(set->nbStates, sizeof(State *)); // the states by number
+    State **buckets = calloc(nbBuckets, sizeof(State *));
+    bool ok = states && buckets;
+    for (size_t i = 0; ok && i < set->nbStates; i++)
+    {
+        uint16_t nbTransitions = set->flatStates[i].nbTransitions;
+        states[i] = malloc(sizeof(State));
+        State **targets = nbTransitions > 0 ? malloc(nbTransitions * TRANSITION_SIZE) : NULL;
+        ok = states[i] && (targets || nbTransitions == 0);
+        if (states[i])
+            *states[i] = (State){targets, NULL, 0, nbTransitions, set->flatStates[i].final, false};
+        else
+            free(targets);
+    }
+    if (!ok)
+    {
+        for (size_t i = 0; states && i < set->nbStates && states[i]; i++)
+        {
+            free(states[i]->targets);
+            free(states[i]);
+        }
+        free(states);
+        free(buckets);
+        return false;
+    }
+
+    for (size_t i = 0; i < set->nbStates; i++)
+    {
+        const FlatTransition *transitions = set->flatTransitions + set->flatStates[i].firstTransition;
+        for (uint16_t j = 0; j < states[i]->nbTransitions; j++)
+        {
+            stateLabels(states[i])[j] = transitions[j].label;
+            states[i]->targets[j] = states[transitions[j].target];
+            states[transitions[j].target]->refs++;
+        }
+    }
+
+    set->buckets = buckets;
+    set->nbBuckets = nbBuckets;
+    for (size_t i = 1; i < set->nbStates; i++)
+        registerAdd(set, states[i], stateHash(states[i]));
+    set->start = states[0];
+    set->start->refs = 1;
+    free(states);
+
+    snapshotClose(set->snapshot);
+    set->snapshot = NULL;
+    set->flatStates = NULL;
+    set->flatTransitions = NULL;
+    return true;
+}
+
+/**
+ * @brief Check that the mapped arrays of a snapshot describe an automaton that
+ *        the traversals can follow without leaving them: the transitions of
+ *        every state lie in the transitions section, are sorted and lead to
+ *        states other than the start state; every other state has an
+ *        incoming transition and there is no cycle, so all of them are
+ *        reached from the start state (and freed with it); the longest
+ *        word is maxKeyLength long, and the words are as many as the keys.
+ *        The states are sorted topologically (Kahn) to check the last three.
+ *
+ * @param header       The header of the snapshot, whose sizes match the sections
+ * @param states       The mapped states
+ * @param transitions  The mapped transitions
+ * @return bool        true if the arrays can be used as they are, false if
+ *                     not or in case of allocation error
+ */
+static bool checkSnapshot(const SnapshotHeader *header, const FlatState *states, const FlatTransition *transitions)
+{
+    size_t nbStates = header->nbStates;
+    uint32_t *inDegrees = calloc(nbStates, sizeof(uint32_t));
+    uint32_t *order = malloc(nbStates * sizeof(uint32_t)); // the states in topological order
+    size_t *heights = malloc(nbStates * sizeof(size_t));   // length of the longest word read from each state
+    uint64_t *nbWords = malloc(nbStates * sizeof(uint64_t));
+    bool ok = inDegrees && order && heights && nbWords;
+
+    for (size_t i = 0; ok && i < nbStates; i++)
+    {
+        const FlatState *state = &states[i];
+        ok = state->final <= 1 && (uint64_t)state->firstTransition + state->nbTransitions <= header->nbTransitions;
+        for (uint16_t j = 0; ok && j < state->nbTransitions; j++)
+        {
+            const FlatTransition *transition = &transitions[state->firstTransition + j];
+            ok = transition->target != 0 && transition->target < nbStates &&
+                 (j == 0 || (unsigned char)transition[-1].label < (unsigned char)transition->label);
+            if (ok)
+                inDegrees[transition->target]++;
+        }
+    }
+
+    // the start state is the only one without incoming transitions
+    size_t nbOrdered = 1;
+    if (ok)
+        order[0] = 0;
+    for (size_t i = 1; ok && i < nbStates; i++)
+        ok = inDegrees[i] > 0;
+    for (size_t i = 0; ok && i < nbOrdered; i++)
+    {
+        const FlatState *state = &states[order[i]];
+        for (uint16_t j = 0; j < state->nbTransitions; j++)
+        {
+            uint32_t target = transitions[state->firstTransition + j].target;
+            if (--inDegrees[target] == 0)
+                order[nbOrdered++] = target;
+        }
+    }
+    ok = ok && nbOrdered == nbStates; // the other states are on a cycle
+
+    for (size_t i = nbStates; ok && i-- > 0;)
+    {
+        uint32_t number = order[i];
+        const FlatState *state = &states[number];
+        heights[number] = 0;
+        nbWords[number] = state->final;
+        for (uint16_t j = 0; j < state->nbTransitions; j++)
+        {
+            uint32_t target = transitions[state->firstTransition + j].target;
+            if (heights[target] + 1 > heights[number])
+                heights[number] = heights[target] + 1;
+            // saturated: only the total of the start state is compared
+            nbWords[number] = nbWords[target] > UINT64_MAX - nbWords[number] ? UINT64_MAX
+                                                                             : nbWords[number] + nbWords[target];
+        }
+        ok = heights[number] <= header->maxKeyLength;
+    }
+    ok = ok && heights[0] == header->maxKeyLength && nbWords[0] == header->numKeys;
+
+    free(inDegrees);
+    free(order);
+    free(heights);
+    free(nbWords);
+    return ok;
+}
+
+/**
+ * @brief SetVisitor appending a copy of each key to a list
+ *
+ * @param key      The key found
+ * @param length   The length of key
+ * @param list     A pointer to a List
+ * @return bool    false in case of allocation error
+ */
+static bool addPrefixToList(const char *key, size_t length, void *list)
+{
+    char *copy = malloc(length + 1);
+    if (!copy)
+        return false;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+
+    if (!listInsertLast(list, copy))
+    {
+        free(copy);
+        return false;
+    }
+    return true;
+}
+
+/* header functions */
+
+Set *setCreateEmpty(void)
+{
+    Set *set = malloc(sizeof(Set));
+    if (!set)
+        return NULL;
+
+    set->numKeys = 0;
+    set->nbStates = 0;
+    set->nbTransitions = 0;
+    set->maxKeyLength = 0;
+    set->flatStates = NULL;
+    set->flatTransitions = NULL;
+    set->snapshot = NULL;
+    set->nbBuckets = INIT_REGISTER_SIZE;
+    set->buckets = calloc(set->nbBuckets, sizeof(State *));
+    set->start = stateNew(set, false);
+    if (!set->buckets || !set->start)
+    {
+        free(set->buckets);
+        free(set->start);
+        free(set);
+        return NULL;
+    }
+    // the start state is never registered: no transition can lead to it
+    set->start->refs = 1;
+
+    return set;
+}
+
+void setFree(Set *set)
+{
+    if (!set)
+        return;
+
+    if (set->snapshot)
+        snapshotClose(set->snapshot);
+    else
+    {
+        stateRelease(set, set->start);
+        free(set->buckets);
+    }
+    free(set);
+}
+
+size_t setNbKeys(const Set *set)
+{
+    if (!set)
+        return (size_t)-1;
+    return set->numKeys;
+}
+
+size_t setMemoryUsage(const Set *set)
+{
+    if (!set)
+        return 0;
+    if (set->snapshot)
+        return sizeof(Set) + set->nbStates * sizeof(FlatState) + set->nbTransitions * sizeof(FlatTransition);
+    return sizeof(Set) + set->nbBuckets * sizeof(State *) +
+           set->nbStates * sizeof(State) + set->nbTransitions * TRANSITION_SIZE;
+}
+
+bool setContains(const Set *set, const char *key)
+{
+    if (!set)
+        return false;
+
+    if (set->snapshot)
+    {
+        uint32_t state = 0;
+        for (size_t i = 0; state != NO_STATE && key[i] != '\0'; i++)
+            state = flatNext(set, state, key[i]);
+        return state != NO_STATE && set->flatStates[state].final;
+    }
+
+    const State *state = set->start;
+    for (size_t i = 0; state && key[i] != '\0'; i++)
+        state = stateNext(state, key[i]);
+
+    return state && state->final;
+}
+
+int setInsert(Set *set, const char *key)
+{
+    if (!set)
+        return -1;
+
+    // a mapped set is only built in memory for a new key
+    if (set->snapshot && setContains(set, key))
+        return 0;
+    if (!detach(set))
+        return -1;
+
+    // the path of the longest prefix of key already in the automaton
+    size_t length = strlen(key);
+    State **path = malloc((length + 1) * sizeof(State *));
+    if (!path)
+        return -1;
+
+    size_t prefixLength = 0;
+    path[0] = set->start;
+    while (prefixLength < length)
+    {
+        const State *next = stateNext(path[prefixLength], key[prefixLength]);
+        if (!next)
+            break;
+        path[++prefixLength] = (State *)next;
+    }
+
+    if (prefixLength == length && path[length]->final)
+    {
+        free(path);
+        return 0;
+    }
+    if (length > set->maxKeyLength)
+        set->maxKeyLength = length;
+
+    // states after the first confluence state are also reached by other words
+    // the states before it are modified in place: they must leave the register
+    // before anything is looked up, or a new state could be merged with one of them
+    size_t firstConfluence = 1;
+    while (firstConfluence <= prefixLength && path[firstConfluence]->refs == 1)
+        registerRemove(set, path[firstConfluence++]);
+
+    State *child = NULL; // rewritten state following the current one
+    for (size_t i = prefixLength + 1; i-- > 0;)
+    {
+        State *state = path[i];
+        if (i >= firstConfluence)
+            state = stateClone(set, state);
+
+        bool ok = state != NULL;
+        if (ok && i == prefixLength)
+        {
+            if (prefixLength == length)
+                state->final = true;
+            else
+            {
+                State *suffix = addSuffix(set, key + prefixLength + 1);
+                ok = suffix && setTransition(set, state, key[prefixLength], suffix);
+            }
+        }
+        else if (ok)
+            ok = setTransition(set, state, key[i], child);
+
+        // a clone of child, or an equivalent of it, may be left unreferenced
+        if (child && child->refs == 0)
+            stateRelease(set, child);
+
+        if (!ok)
+        {
+            // the automaton is left valid but some states may be unregistered
+            if (state && state->refs == 0)
+                stateRelease(set, state);
+            free(path);
+            return -1;
+        }
+
+        if (i == 0)
+            break;
+
+        child = replaceOrRegister(set, state);
+        if (!child)
+        {
+            free(path);
+            return -1;
+        }
+    }
+
+    free(path);
+    set->numKeys++;
+    return 1;
+}
+
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys)
+{
+    size_t nbSorted;
+    const char **sorted = sortedKeys(keys, nbKeys, &nbSorted);
+    if (!sorted)
+        return NULL;
+
+    size_t maxLength = 0;
+    for (size_t i = 0; i < nbSorted; i++)
+    {
+        size_t length = strlen(sorted[i]);
+        if (length > maxLength)
+            maxLength = length;
+    }
+
+    Set *set = setCreateEmpty();
+    State **path = malloc((maxLength + 1) * sizeof(State *));
+    if (!set || !path)
+    {
+        setFree(set);
+        free(path);
+        free(sorted);
+        return NULL;
+    }
+
+    // the keys are distinct and sorted: a key shares with the previous one a
+    // prefix shorter than itself, and the rest of the previous path is final
+    path[0] = set->start;
+    size_t pathLength = 0;
+    bool ok = true;
+    for (size_t k = 0; ok && k < nbSorted; k++)
+    {
+        const char *key = sorted[k];
+        size_t prefixLength = k == 0 ? 0 : sortedKeysCommonPrefix(sorted[k - 1], key);
+        ok = freezePath(set, path, pathLength, prefixLength);
+
+        // transitions leaving a state of the path are added in increasing order
+        for (pathLength = prefixLength; ok && key[pathLength] != '\0'; pathLength++)
+        {
+            State *state = stateNew(set, false);
+            ok = state && setTransition(set, path[pathLength], key[pathLength], state);
+            if (!ok && state)
+                stateRelease(set, state);
+            else if (ok)
+                path[pathLength + 1] = state;
+        }
+
+        if (ok)
+        {
+            path[pathLength]->final = true;
+            if (pathLength > set->maxKeyLength)
+                set->maxKeyLength = pathLength;
+            set->numKeys++;
+        }
+    }
+    ok = ok && freezePath(set, path, pathLength, 0);
+
+    free(path);
+    free(sorted);
+    if (!ok)
+    {
+        setFree(set);
+        return NULL;
+    }
+    return set;
+}
+
+List *setGetAllStringPrefixes(const Set *set, const char *str)
+{
+    List *foundPrefixes = listNew();
+    if (!foundPrefixes)
+        return NULL;
+
+    if (!setVisitAllStringPrefixes(set, str, addPrefixToList, foundPrefixes))
+    {
+        listFree(foundPrefixes, true);
+        return NULL;
+    }
+    return foundPrefixes;
+}
+
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context)
+{
+    // keys are not stored: a key found is the start of str itself
+    if (set->snapshot)
+    {
+        uint32_t state = 0;
+        for (size_t i = 0; str[i] != '\0'; i++)
+        {
+            state = flatNext(set, state, str[i]);
+            if (state == NO_STATE)
+                return true;
+            if (set->flatStates[state].final && !visit(str, i + 1, context))
+                return false;
+        }
+        return true;
+    }
+
+    const State *state = set->start;
+    for (size_t i = 0; str[i] != '\0'; i++)
+    {
+        state = stateNext(state, str[i]);
+        if (!state)
+            return true;
+        if (state->final && !visit(str, i + 1, context))
+            return false;
+    }
+    return true;
+}
+
+/* Keys */
+
+/**
+ * @brief Call visit on the keys read from a state, in order
+ *
+ * @param state    A state
+ * @param path     A buffer of set->maxKeyLength characters, starting with
+ *                 the string read from the start state to state
+ * @param length   The length of that string
+ * @param visit    The function called for each key
+ * @param context  Passed as is to visit
+ * @return bool    false if the visit was stopped
+ */
+static bool visitRec(const State *state, char *path, size_t length, SetVisitor visit, void *context)
+{
+    if (state->final && !visit(path, length, context))
+        return false;
+
+    for (uint16_t i = 0; i < state->nbTransitions; i++)
+    {
+        path[length] = stateLabels(state)[i];
+        if (!visitRec(state->targets[i], path, length + 1, visit, context))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Same as visitRec, for a mapped state
+ *
+ * @param set      A pointer to a mapped set
+ * @param state    The number of a state
+ * @param path     A buffer of set->maxKeyLength characters, starting with
+ *                 the string read from the start state to state
+ * @param length   The length of that string
+ * @param visit    The function called for each key
+ * @param context  Passed as is to visit
+ * @return bool    false if the visit was stopped
+ */
+static bool flatVisitRec(const Set *set, uint32_t state, char *path, size_t length, SetVisitor visit, void *context)
+{
+    if (set->flatStates[state].final && !visit(path, length, context))
+        return false;
+
+    const FlatTransition *transitions = set->flatTransitions + set->flatStates[state].firstTransition;
+    for (uint16_t i = 0; i < set->flatStates[state].nbTransitions; i++)
+    {
+        path[length] = transitions[i].label;
+        if (!flatVisitRec(set, transitions[i].target, path, length + 1, visit, context))
+            return false;
+    }
+    return true;
+}
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context)
+{
+    // no key is longer than the longest one inserted
+    char *path = malloc(set->maxKeyLength + 1);
+    if (!path)
+        return false;
+
+    bool ok = set->snapshot ? flatVisitRec(set, 0, path, 0, visit, context)
+                            : visitRec(set->start, path, 0, visit, context);
+    free(path);
+    return ok;
+}
+
+/* Snapshot */
+
+bool setSave(const Set *set, const char *filename)
+{
+    SnapshotKeys keys = {NULL, 0, 0};
+    bool ok = setVisitAllKeys(set, snapshotKeysAdd, &keys);
+
+    // a mapped set is written as it is
+    SnapshotHeader header = {set->numKeys, set->nbStates, set->nbTransitions, set->maxKeyLength};
+    FlatState *states = NULL;
+    FlatTransition *transitions = NULL;
+    ok = ok && (set->snapshot || flatten(set, &states, &transitions, &header));
+
+    SnapshotSection sections[] = {
+        {keys.data, keys.size},
+        {&header, sizeof(SnapshotHeader)},
+        {set->snapshot ? set->flatStates : states, header.nbStates * sizeof(FlatState)},
+        {set->snapshot ? set->flatTransitions : transitions, header.nbTransitions * sizeof(FlatTransition)},
+    };
+    ok = ok && snapshotWrite(filename, "DAWG", sections, 4);
+    free(keys.data);
+    free(states);
+    free(transitions);
+    return ok;
+}
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "DAWG");
+    if (!snapshot)
+        return NULL;
+
+    size_t headerSize, statesSize, transitionsSize;
+    const SnapshotHeader *header = snapshotSection(snapshot, SECTION_HEADER, &headerSize);
+    const FlatState *states = snapshotSection(snapshot, SECTION_STATES, &statesSize);
+    const FlatTransition *transitions = snapshotSection(snapshot, SECTION_TRANSITIONS, &transitionsSize);
+
+    Set *set = malloc(sizeof(Set));
+    if (!set || !header || !states || !transitions || headerSize != sizeof(SnapshotHeader) ||
+        header->nbStates == 0 || header->nbStates >= NO_STATE || header->nbTransitions >= UINT32_MAX ||
+        statesSize != header->nbStates * sizeof(FlatState) ||
+        transitionsSize != header->nbTransitions * sizeof(FlatTransition) ||
+        !checkSnapshot(header, states, transitions))
+    {
+        free(set);
+        snapshotClose(snapshot);
+        return NULL;
+    }
+
+    // both are only read until detach builds the states in memory
+    set->start = NULL;
+    set->numKeys = header->numKeys;
+    set->buckets = NULL;
+    set->nbBuckets = 0;
+    set->nbStates = header->nbStates;
+    set->nbTransitions = header->nbTransitions;
+    set->maxKeyLength = header->maxKeyLength;
+    set->flatStates = states;
+    set->flatTransitions = transitions;
+    set->snapshot = snapshot;
+    return set;
+}
+
+/* Cursor */
+
+struct SetCursor_t
+{
+    const Set *set;
+    const State *state; // if the set is in memory, NULL once no key can be read anymore
+    uint32_t flat;      // if the set is mapped, NO_STATE once no key can be read anymore
+};
+
+SetCursor *setCursorCreate(const Set *set)
+{
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}
+
+void setCursorFree(SetCursor *cursor)
+{
+    free(cursor);
+}
+
+void setCursorReset(SetCursor *cursor)
+{
+    cursor->state = cursor->set->start;
+    cursor->flat = 0;
+}
+
+int setCursorStep(SetCursor *cursor, char c)
+{
+    if (cursor->set->snapshot)
+    {
+        if (cursor->flat == NO_STATE)
+            return 0;
+
+        cursor->flat = flatNext(cursor->set, cursor->flat, c);
+        if (cursor->flat == NO_STATE)
+            return 0;
+
+        const FlatState *state = &cursor->set->flatStates[cursor->flat];
+        return (state->nbTransitions > 0 ? SET_CURSOR_PREFIX : 0) | (state->final ? SET_CURSOR_KEY : 0);
+    }
+
+    if (!cursor->state)
+        return 0;
+
+    cursor->state = stateNext(cursor->state, c);
+    if (!cursor->state)
+        return 0;
+
+    int flags = cursor->state->nbTransitions > 0 ? SET_CURSOR_PREFIX : 0;
+    if (cursor->state->final)
+        flags |= SET_CURSOR_KEY;
+    return flags;
+}
@@ -0,0 +1,845 @@
+/* ========================================================================= *
+ * DoubleArray
+ *
+ * Implementation of Set.h based on a double-array trie. Each node of the trie
+ * is a cell of a single array; the child of node s reading character c is
+ * the cell t = base[s] + c, which is valid if check[t] == s. Reading a
+ * character is thus two array reads, and no pointer is stored: the arrays
+ * can be written as they are and used again from a mapped file.
+ *
+ * Keys are not stored, a flag tells whether a key ends at a node. Inserting
+ * a character whose cell is taken by the child of another node moves all the
+ * children of the current node to a new base where they all fit. Unused cells
+ * are kept in a circular doubly linked list threaded through their own base
+ * and check, so that looking for a base only visits unused cells.
+ *
+ * A snapshot holds the used part of the arrays as they are, and setOpen uses
+ * them from the mapped file. They are copied in memory, and the list of
+ * unused cells rebuilt, by the first insertion.
+ * ========================================================================= */
+
+#include "Set.h"
+#include "Snapshot.h"
+#include "SortedKeys.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROOT 0
+#define NO_PARENT INT32_MAX    // check of the root, which no cell index equals
+#define INIT_CAPACITY 1024
+#define NB_CODES 256           // a character c is read with code (unsigned char)c
+#define MAX_TRIALS 256         // unused cells tried before placing children at the end
+
+#define TERMINAL 1             // a key ends at the node
+#define HAS_CHILDREN 2         // base is valid
+
+/* Structures */
+
+typedef struct Cell_t
+{
+    int32_t base;  // children of the node are at base + code, -(previous + 1) if unused
+    int32_t check; // parent of the node, -(next + 1) if unused
+} Cell;
+
+struct Set_t
+{
+    Cell *cells;
+    uint8_t *flags;    // TERMINAL and HAS_CHILDREN of each cell
+    size_t capacity;   // number of cells
+    size_t end;        // cells from this index on are unused
+    int32_t freeHead;  // an unused cell, -1 if there is none
+    size_t numKeys;
+    size_t maxKeyLength;
+    Snapshot *snapshot; // the file holding cells and flags if they are mapped, NULL otherwise
+};
+
+/* Layout of the snapshot files */
+
+#define SECTION_HEADER 1
+#define SECTION_CELLS 2
+#define SECTION_FLAGS 3
+
+typedef struct SnapshotHeader_t
+{
+    uint64_t nbCells; // the cells after them are unused
+    uint64_t numKeys;
+    uint64_t maxKeyLength;
+} SnapshotHeader;
+
+/* Prototypes */
+
+static int32_t childIndex(const Set *set, int32_t node, char c);
+static bool reserve(Set *set, size_t capacity);
+static bool isFree(const Set *set, int64_t index);
+static void linkFree(Set *set, int32_t index);
+static void occupy(Set *set, size_t index, int32_t parent);
+static void release(Set *set, size_t index);
+static int collectCodes(const Set *set, int32_t node, int code, int *codes);
+static bool findBase(Set *set, const int *codes, int nbCodes, int32_t *base);
+static int32_t addChild(Set *set, int32_t node, char c);
+static bool buildRec(Set *set, int32_t node, const char **keys, size_t nbKeys, size_t depth);
+static bool detach(Set *set);
+static bool checkSnapshot(const SnapshotHeader *header, const Cell *cells, const uint8_t *flags);
+static const char *readKey(const Set *set, int32_t node, char *buffer, size_t *length);
+static bool addPrefixToList(const char *key, size_t length, void *list);
+
+/* static functions */
+
+/**
+ * @brief Follow the transition of a node labelled by a character
+ *
+ * @param set      A pointer to a set
+ * @param node     A node
+ * @param c        A character (not \0)
+ * @return int32_t The child of node reading c, or -1 if there is none
+ */
+static int32_t childIndex(const Set *set, int32_t node, char c)
+{
+    if (!(set->flags[node] & HAS_CHILDREN))
+        return -1;
+
+    int64_t t = (int64_t)set->cells[node].base + (unsigned char)c;
+    if (t < 0 || t >= (int64_t)set->capacity || set->cells[t].check != node)
+        return -1;
+    return (int32_t)t;
+}
+
+/**
+ * @brief Make sure the arrays hold at least capacity cells
+ *
+ * @param set      A pointer to a set
+ * @param capacity The number of cells needed
+ * @return bool    false in case of allocation error
+ */
+static bool reserve(Set *set, size_t capacity)
+{
+    if (capacity <= set->capacity)
+        return true;
+    if (capacity > INT32_MAX)
+        return false;
+
+    size_t newCapacity = set->capacity;
+    while (newCapacity < capacity)
+        newCapacity *= 2;
+
+    Cell *cells = realloc(set->cells, newCapacity * sizeof(Cell));
+    if (!cells)
+        return false;
+    set->cells = cells;
+
+    uint8_t *flags = realloc(set->flags, newCapacity);
+    if (!flags)
+        return false;
+    set->flags = flags;
+
+    size_t oldCapacity = set->capacity;
+    set->capacity = newCapacity;
+    for (size_t i = oldCapacity; i < newCapacity; i++)
+        linkFree(set, (int32_t)i);
+    return true;
+}
+
+/**
+ * @brief Check whether a cell is unused. Cells past the end of the arrays are,
+ *        negative indices are not.
+ *
+ * @param set      A pointer to a set
+ * @param index    An index
+ * @return bool
+ */
+static bool isFree(const Set *set, int64_t index)
+{
+    return index >= (int64_t)set->capacity || (index >= 0 && set->cells[index].check < 0);
+}
+
+/**
+ * @brief Add a cell to the list of unused cells, before its head
+ *
+ * @param set      A pointer to a set
+ * @param index    A cell that is not used
+ */
+static void linkFree(Set *set, int32_t index)
+{
+    Cell *cells = set->cells;
+    set->flags[index] = 0;
+
+    if (set->freeHead < 0)
+    {
+        cells[index].base = -(index + 1);
+        cells[index].check = -(index + 1);
+        set->freeHead = index;
+        return;
+    }
+
+    int32_t next = set->freeHead;
+    int32_t previous = -cells[next].base - 1;
+    cells[index].base = -(previous + 1);
+    cells[index].check = -(next + 1);
+    cells[previous].check = -(index + 1);
+    cells[next].base = -(index + 1);
+}
+
+/**
+ * @brief Use a cell, allocated and free, for a new child of parent
+ *
+ * @param set      A pointer to a set
+ * @param index    The cell
+ * @param parent   The parent of the new node
+ */
+static void occupy(Set *set, size_t index, int32_t parent)
+{
+    Cell *cells = set->cells;
+    int32_t next = -cells[index].check - 1;
+    int32_t previous = -cells[index].base - 1;
+
+    if (next == (int32_t)index)
+        set->freeHead = -1;
+    else
+    {
+        cells[previous].check = -(next + 1);
+        cells[next].base = -(previous + 1);
+        if (set->freeHead == (int32_t)index)
+            set->freeHead = next;
+    }
+
+    cells[index].base = 0;
+    cells[index].check = parent;
+    set->flags[index] = 0;
+    if (index >= set->end)
+        set->end = index + 1;
+}
+
+/**
+ * @brief Give a cell back
+ *
+ * @param set      A pointer to a set
+ * @param index    A used cell
+ */
+static void release(Set *set, size_t index)
+{
+    linkFree(set, (int32_t)index);
+}
+
+/**
+ * @brief List the codes of the children of a node, in increasing order,
+ *        together with an additional code.
+ *
+ * @param set      A pointer to a set
+ * @param node     A node
+ * @param code     The code of a child to add
+ * @param codes    An array of NB_CODES codes, filled by the function
+ * @return int     The number of codes
+ */
+static int collectCodes(const Set *set, int32_t node, int code, int *codes)
+{
+    int nbCodes = 0;
+    int64_t base = set->cells[node].base;
+
+    for (int c = 1; c < NB_CODES; c++)
+    {
+        bool child = (set->flags[node] & HAS_CHILDREN) && base + c >= 0 &&
+                     base + c < (int64_t)set->capacity && set->cells[base + c].check == node;
+        if (child || c == code)
+            codes[nbCodes++] = c;
+    }
+    return nbCodes;
+}
+
+/**
+ * @brief Find a base such that the cells base + codes[i] are all unused.
+ *        At most MAX_TRIALS unused cells are tried for codes[0], after which
+ *        the children go after the last used cell. The list of unused cells then
+ *        starts where the search stopped, so that cells that do not fit are
+ *        not tried first again and again.
+ *
+ * @param set      A pointer to a set
+ * @param codes    Increasing codes
+ * @param nbCodes  The number of codes, at least 1
+ * @param base     Set to the base found, possibly negative
+ * @return bool    false in case of allocation error
+ */
+static bool findBase(Set *set, const int *codes, int nbCodes, int32_t *base)
+{
+    int64_t found = (int64_t)set->end - codes[0];
+    int32_t index = set->freeHead;
+
+    for (int trials = 0; index >= 0; trials++)
+    {
+        if (trials == MAX_TRIALS)
+        {
+            set->freeHead = index;
+            break;
+        }
+
+        int64_t candidate = (int64_t)index - codes[0];
+        int i = 1;
+        while (i < nbCodes && isFree(set, candidate + codes[i]))
+            i++;
+
+        if (i == nbCodes)
+        {
+            found = candidate;
+            break;
+        }
+
+        index = -set->cells[index].check - 1;
+        if (index == set->freeHead)
+            break;
+    }
+
+    if (found + codes[nbCodes - 1] + 1 > INT32_MAX || !reserve(set, (size_t)(found + codes[nbCodes - 1] + 1)))
+        return false;
+
+    *base = (int32_t)found;
+    return true;
+}
+
+/**
+ * @brief Add the child of a node reading a character. If its cell is used,
+ *        the children of the node are moved to a new base first.
+ *
+ * @param set      A pointer to a set
+ * @param node     A node without child reading c
+ * @param c        A character (not \0)
+ * @return int32_t The new child, or -1 in case of allocation error
+ */
+static int32_t addChild(Set *set, int32_t node, char c)
+{
+    int code = (unsigned char)c;
+
+    if (set->flags[node] & HAS_CHILDREN)
+    {
+        int64_t t = (int64_t)set->cells[node].base + code;
+        if (t >= 0)
+        {
+            if (t >= INT32_MAX || !reserve(set, (size_t)t + 1))
+                return -1;
+            if (set->cells[t].check < 0)
+            {
+                occupy(set, (size_t)t, node);
+                return (int32_t)t;
+            }
+        }
+    }
+
+    int codes[NB_CODES];
+    int nbCodes = collectCodes(set, node, code, codes);
+
+    int32_t base;
+    if (!findBase(set, codes, nbCodes, &base))
+        return -1;
+
+    int32_t oldBase = set->cells[node].base;
+    for (int i = 0; i < nbCodes; i++)
+    {
+        int32_t to = base + codes[i];
+        occupy(set, (size_t)to, node);
+        if (codes[i] == code)
+            continue;
+
+        // move the child, and tell its own children about their new parent
+        int32_t from = oldBase + codes[i];
+        set->cells[to].base = set->cells[from].base;
+        set->flags[to] = set->flags[from];
+        if (set->flags[from] & HAS_CHILDREN)
+        {
+            int64_t childBase = set->cells[from].base;
+            for (int k = 1; k < NB_CODES; k++)
+            {
+                int64_t grandChild = childBase + k;
+                if (grandChild >= 0 && grandChild < (int64_t)set->capacity &&
+                    set->cells[grandChild].check == from)
+                    set->cells[grandChild].check = to;
+            }
+        }
+        release(set, (size_t)from);
+    }
+
+    set->cells[node].base = base;
+    set->flags[node] |= HAS_CHILDREN;
+    return base + code;
+}
+
+/**
+ * @brief Build the subtree of a node from sorted keys. All the children of a
+ *        node are known before any of them is placed, so a single base is
+ *        searched for each node and no child ever has to move.
+ *
+ * @param set      A pointer to a set
+ * @param node     A node without children
+ * @param keys     Distinct sorted keys, starting with the path to node
+ * @param nbKeys   The number of keys
+ * @param depth    The length of the path to node
+ * @return bool    false in case of allocation error
+ */
+static bool buildRec(Set *set, int32_t node, const char **keys, size_t nbKeys, size_t depth)
+{
+    if (nbKeys > 0 && keys[0][depth] == '\0') // only the first key can end here
+    {
+        set->flags[node] |= TERMINAL;
+        if (depth > set->maxKeyLength)
+            set->maxKeyLength = depth;
+        keys++;
+        nbKeys--;
+    }
+    if (nbKeys == 0)
+        return true;
+
+    int codes[NB_CODES];
+    int nbCodes = 0;
+    for (size_t i = 0; i < nbKeys; i++)
+    {
+        int code = (unsigned char)keys[i][depth];
+        if (nbCodes == 0 || codes[nbCodes - 1] != code)
+            codes[nbCodes++] = code;
+    }
+
+    int32_t base;
+    if (!findBase(set, codes, nbCodes, &base))
+        return false;
+    for (int i = 0; i < nbCodes; i++)
+        occupy(set, (size_t)(base + codes[i]), node);
+    set->cells[node].base = base;
+    set->flags[node] |= HAS_CHILDREN;
+
+    size_t start = 0;
+    for (int i = 0; i < nbCodes; i++)
+    {
+        size_t end = start + 1;
+        while (end < nbKeys && (unsigned char)keys[end][depth] == codes[i])
+            end++;
+        if (!buildRec(set, base + codes[i], keys + start, end - start, depth + 1))
+            return false;
+        start = end;
+    }
+    return true;
+}
+
+/**
+ * @brief Copy in memory the arrays of a set opened from a snapshot, so that
+ *        it can be modified, and link its unused cells.
+ *
+ * @param set      A pointer to a set
+ * @return bool    false in case of allocation error
+ */
+static bool detach(Set *set)
+{
+    if (!set->snapshot)
+        return true;
+
+    Cell *cells = malloc(set->capacity * sizeof(Cell));
+    uint8_t *flags = malloc(set->capacity);
+    if (!cells || !flags)
+    {
+        free(cells);
+        free(flags);
+        return false;
+    }
+    memcpy(cells, set->cells, set->capacity * sizeof(Cell));
+    memcpy(flags, set->flags, set->capacity);
+
+    set->cells = cells;
+    set->flags = flags;
+    snapshotClose(set->snapshot);
+    set->snapshot = NULL;
+
+    // the links saved in unused cells may lead past the saved cells
+    set->freeHead = -1;
+    for (size_t i = 0; i < set->capacity; i++)
+    {
+        if (cells[i].check < 0)
+            linkFree(set, (int32_t)i);
+    }
+    return true;
+}
+
+/**
+ * @brief Check that the mapped arrays of a snapshot describe a trie that the
+ *        lookups and readKey can follow without leaving them: the parent of
+ *        every used cell but the root is a used cell with children, whose
+ *        base leads back to it with a character other than \0; going up
+ *        from any used cell reaches the root, the deepest cell being
+ *        maxKeyLength characters down; and the terminal cells are as many as
+ *        the keys. Depths are computed once per cell, going up from each cell
+ *        until a cell of known depth.
+ *
+ * @param header   The header of the snapshot, whose sizes match the sections
+ * @param cells    The mapped cells
+ * @param flags    The mapped flags
+ * @return bool    true if the arrays can be used as they are, false if not
+ *                 or in case of allocation error
+ */
+static bool checkSnapshot(const SnapshotHeader *header, const Cell *cells, const uint8_t *flags)
+{
+    // a key of length n uses n + 1 cells
+    size_t nbCells = header->nbCells;
+    if (header->maxKeyLength >= nbCells || cells[ROOT].check != NO_PARENT)
+        return false;
+
+    int64_t *depths = malloc(nbCells * sizeof(int64_t)); // -1 until known
+    int32_t *path = malloc((header->maxKeyLength + 1) * sizeof(int32_t));
+    bool ok = depths && path;
+    for (size_t i = 0; ok && i < nbCells; i++)
+        depths[i] = -1;
+    if (ok)
+        depths[ROOT] = 0;
+
+    uint64_t nbTerminals = 0;
+    int64_t maxDepth = 0;
+    for (size_t i = 0; ok && i < nbCells; i++)
+    {
+        ok = flags[i] <= (TERMINAL | HAS_CHILDREN);
+        if (!ok || cells[i].check < 0) // unused
+            continue;
+        if (flags[i] & TERMINAL)
+            nbTerminals++;
+
+        // climb until a cell of known depth, at most maxKeyLength cells
+        size_t pathLength = 0;
+        int32_t node = (int32_t)i;
+        while (ok && depths[node] < 0)
+        {
+            int32_t parent = cells[node].check;
+            int64_t code = parent >= 0 && (size_t)parent < nbCells ? (int64_t)node - cells[parent].base : -1;
+            ok = pathLength < header->maxKeyLength && code > 0 && code < NB_CODES &&
+                 cells[parent].check >= 0 && (flags[parent] & HAS_CHILDREN);
+            if (ok)
+            {
+                path[pathLength++] = node;
+                node = parent;
+            }
+        }
+
+        for (int64_t depth = ok ? depths[node] : 0; ok && pathLength > 0;)
+        {
+            depths[path[--pathLength]] = ++depth;
+            ok = depth <= (int64_t)header->maxKeyLength;
+            if (depth > maxDepth)
+                maxDepth = depth;
+        }
+    }
+
+    free(depths);
+    free(path);
+    return ok && maxDepth == (int64_t)header->maxKeyLength && nbTerminals == header->numKeys;
+}
+
+/**
+ * @brief Read the key ending at a node. It is read from the node up to the
+ *        root, the character leading to a node being its index minus the
+ *        base of its parent, so it is written from the end of the buffer.
+ *
+ * @param set      A pointer to a set
+ * @param node     A terminal node
+ * @param buffer   A buffer of set->maxKeyLength characters
+ * @param length   Set to the length of the key
+ * @return const char* The key, at the end of buffer (not followed by a \0)
+ */
+static const char *readKey(const Set *set, int32_t node, char *buffer, size_t *length)
+{
+    char *key = buffer + set->maxKeyLength;
+    while (node != ROOT)
+    {
+        int32_t parent = set->cells[node].check;
+        *--key = (char)(node - set->cells[parent].base);
+        node = parent;
+    }
+
+    *length = (size_t)(buffer + set->maxKeyLength - key);
+    return key;
+}
+
+/**
+ * @brief SetVisitor appending a copy of each key to a list
+ *
+ * @param key      The key found
+ * @param length   The length of key
+ * @param list     A pointer to a List
+ * @return bool    false in case of allocation error
+ */
+static bool addPrefixToList(const char *key, size_t length, void *list)
+{
+    char *copy = malloc(length + 1);
+    if (!copy)
+        return false;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+
+    if (!listInsertLast(list, copy))
+    {
+        free(copy);
+        return false;
+    }
+    return true;
+}
+
+/* header functions */
+
+Set *setCreateEmpty(void)
+{
+    Set *set = malloc(sizeof(Set));
+    if (!set)
+        return NULL;
+
+    set->capacity = INIT_CAPACITY;
+    set->numKeys = 0;
+    set->maxKeyLength = 0;
+    set->snapshot = NULL;
+    set->cells = malloc(set->capacity * sizeof(Cell));
+    set->flags = malloc(set->capacity);
+    if (!set->cells || !set->flags)
+    {
+        free(set->cells);
+        free(set->flags);
+        free(set);
+        return NULL;
+    }
+
+    set->freeHead = -1;
+    set->end = 0;
+    for (size_t i = 0; i < set->capacity; i++)
+        linkFree(set, (int32_t)i);
+    occupy(set, ROOT, NO_PARENT);
+
+    return set;
+}
+
+void setFree(Set *set)
+{
+    if (!set)
+        return;
+
+    if (set->snapshot)
+        snapshotClose(set->snapshot);
+    else
+    {
+        free(set->cells);
+        free(set->flags);
+    }
+    free(set);
+}
+
+size_t setNbKeys(const Set *set)
+{
+    if (!set)
+        return (size_t)-1;
+    return set->numKeys;
+}
+
+size_t setMemoryUsage(const Set *set)
+{
+    if (!set)
+        return 0;
+    return sizeof(Set) + set->capacity * (sizeof(Cell) + 1);
+}
+
+bool setContains(const Set *set, const char *key)
+{
+    if (!set)
+        return false;
+
+    int32_t node = ROOT;
+    for (size_t i = 0; node >= 0 && key[i] != '\0'; i++)
+        node = childIndex(set, node, key[i]);
+
+    return node >= 0 && (set->flags[node] & TERMINAL);
+}
+
+int setInsert(Set *set, const char *key)
+{
+    if (!set)
+        return -1;
+
+    if (setContains(set, key))
+        return 0;
+    if (!detach(set))
+        return -1;
+
+    int32_t node = ROOT;
+    size_t length = 0;
+    for (; key[length] != '\0'; length++)
+    {
+        int32_t child = childIndex(set, node, key[length]);
+        if (child < 0)
+        {
+            child = addChild(set, node, key[length]);
+            if (child < 0)
+                return -1;
+        }
+        node = child;
+    }
+
+    set->flags[node] |= TERMINAL;
+    if (length > set->maxKeyLength)
+        set->maxKeyLength = length;
+    set->numKeys++;
+    return 1;
+}
+
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys)
+{
+    size_t nbSorted;
+    const char **sorted = sortedKeys(keys, nbKeys, &nbSorted);
+    if (!sorted)
+        return NULL;
+
+    Set *set = setCreateEmpty();
+    if (set && !buildRec(set, ROOT, sorted, nbSorted, 0))
+    {
+        setFree(set);
+        set = NULL;
+    }
+    if (set)
+        set->numKeys = nbSorted;
+
+    free(sorted);
+    return set;
+}
+
+List *setGetAllStringPrefixes(const Set *set, const char *str)
+{
+    List *foundPrefixes = listNew();
+    if (!foundPrefixes)
+        return NULL;
+
+    if (!setVisitAllStringPrefixes(set, str, addPrefixToList, foundPrefixes))
+    {
+        listFree(foundPrefixes, true);
+        return NULL;
+    }
+    return foundPrefixes;
+}
+
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context)
+{
+    // keys are not stored: a key found is the start of str itself
+    int32_t node = ROOT;
+    for (size_t i = 0; str[i] != '\0'; i++)
+    {
+        node = childIndex(set, node, str[i]);
+        if (node < 0)
+            return true;
+        if ((set->flags[node] & TERMINAL) && !visit(str, i + 1, context))
+            return false;
+    }
+    return true;
+}
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context)
+{
+    // the keys are visited in the order of their last node in the array
+    char *buffer = malloc(set->maxKeyLength + 1);
+    if (!buffer)
+        return false;
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < set->end; i++)
+    {
+        if (set->cells[i].check >= 0 && (set->flags[i] & TERMINAL))
+        {
+            size_t length;
+            const char *key = readKey(set, (int32_t)i, buffer, &length);
+            ok = visit(key, length, context);
+        }
+    }
+    free(buffer);
+    return ok;
+}
+
+/* Snapshot */
+
+bool setSave(const Set *set, const char *filename)
+{
+    SnapshotKeys keys = {NULL, 0, 0};
+    bool ok = setVisitAllKeys(set, snapshotKeysAdd, &keys);
+
+    SnapshotHeader header = {set->end, set->numKeys, set->maxKeyLength};
+    SnapshotSection sections[] = {
+        {keys.data, keys.size},
+        {&header, sizeof(SnapshotHeader)},
+        {set->cells, set->end * sizeof(Cell)},
+        {set->flags, set->end},
+    };
+    ok = ok && snapshotWrite(filename, "DoubleArray", sections, 4);
+    free(keys.data);
+    return ok;
+}
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "DoubleArray");
+    if (!snapshot)
+        return NULL;
+
+    size_t headerSize, cellsSize, flagsSize;
+    const SnapshotHeader *header = snapshotSection(snapshot, SECTION_HEADER, &headerSize);
+    const Cell *cells = snapshotSection(snapshot, SECTION_CELLS, &cellsSize);
+    const uint8_t *flags = snapshotSection(snapshot, SECTION_FLAGS, &flagsSize);
+
+    Set *set = malloc(sizeof(Set));
+    if (!set || !header || !cells || !flags || headerSize != sizeof(SnapshotHeader) ||
+        header->nbCells == 0 || header->nbCells > INT32_MAX || cellsSize != header->nbCells * sizeof(Cell) ||
+        flagsSize != header->nbCells || !checkSnapshot(header, cells, flags))
+    {
+        free(set);
+        snapshotClose(snapshot);
+        return NULL;
+    }
+
+    // both are only read until detach copies them
+    set->cells = (Cell *)cells;
+    set->flags = (uint8_t *)flags;
+    set->capacity = header->nbCells;
+    set->end = header->nbCells;
+    set->numKeys = header->numKeys;
+    set->maxKeyLength = header->maxKeyLength;
+    set->freeHead = -1;
+    set->snapshot = snapshot;
+    return set;
+}
+
+/* Cursor */
+
+struct SetCursor_t
+{
+    const Set *set;
+    int32_t node; // -1 once no key can be read anymore
+};
+
+SetCursor *setCursorCreate(const Set *set)
+{
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}
+
+void setCursorFree(SetCursor *cursor)
+{
+    free(cursor);
+}
+
+void setCursorReset(SetCursor *cursor)
+{
+    cursor->node = ROOT;
+}
+
+int setCursorStep(SetCursor *cursor, char c)
+{
+    if (cursor->node < 0 || c == '\0')
+    {
+        cursor->node = -1;
+        return 0;
+    }
+
+    cursor->node = childIndex(cursor->set, cursor->node, c);
+    if (cursor->node < 0)
+        return 0;
+
+    uint8_t flags = cursor->set->flags[cursor->node];
+    return ((flags & HAS_CHILDREN) ? SET_CURSOR_PREFIX : 0) | ((flags & TERMINAL) ? SET_CURSOR_KEY : 0);
+}
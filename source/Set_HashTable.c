@@ -3,60 +3,213 @@
  *
  * Implementation of HashTable.h based on linked lists.
  *
+ * The table starts small and doubles when the load factor exceeds
+ * MAX_LOAD_FACTOR. The elements of the previous table are then moved a few
+ * buckets at a time by the following insertions (incremental rehashing), so
+ * that no single insertion pays for a whole resize. Until it is empty, the
+ * previous table is searched as well.
+ *
+ * Unless PREFIX_FILTER is defined to 0, the set also records the hashes of
+ * all the proper prefixes of its keys in a Bloom filter, so that a prefix
+ * search can stop as soon as the string read so far cannot be extended into
+ * a key. The filter never misses a prefix but may report a few false ones.
+ * It is blocked (all the bits of a hash lie in the same 64-bit word, so a
+ * test costs a single memory access) and sized with the table: when the
+ * table grows, a new filter is filled by rehashStep with the prefixes of the
+ * keys it moves, and the previous filter is searched until it is released.
+ *
  * ========================================================================= */
 
 #include "Set.h"
+#include "Snapshot.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define INIT_CAPACITY 200013
+#define INIT_CAPACITY 16 // must be a power of 2
+#define MAX_LOAD_FACTOR 1
+#define REHASH_STEP 4 // number of buckets of the previous table moved by each insertion
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+#ifndef PREFIX_FILTER
+#define PREFIX_FILTER 1
+#endif
+#define FILTER_BITS_PER_BUCKET 16 // keys have about 1.5 distinct proper prefixes each
+#define FILTER_NB_PROBES 4
 
 /* Structures */
 
 typedef struct LLElement_t
 {
     char *key;
+    uint64_t hash; // hashFunction(key)
     struct LLElement_t *next;
 } LLElement;
 
 struct Set_t
 {
     LLElement **table;
-    size_t tableSize;
+    size_t tableSize;     // a power of 2
+    LLElement **oldTable; // previous table while it is being emptied, NULL otherwise
+    size_t oldTableSize;
+    size_t rehashIndex;   // the buckets of oldTable before this index are empty
     size_t numElements;
+    size_t maxKeyLength;
+    size_t keyBytes;      // memory used by the keys
+    uint64_t *filter;     // prefix filter of table, NULL if PREFIX_FILTER is 0
+    uint64_t *oldFilter;  // prefix filter of oldTable
 };
 
 /* Prototypes */
 
-static LLElement *findElement(const Set *set, const char *key);
+static LLElement *findInChain(LLElement *element, const char *key, size_t length, uint64_t hash);
+static LLElement *findElement(const Set *set, const char *key, size_t length, uint64_t hash);
+static size_t bucketIndex(uint64_t hash, size_t tableSize);
+static void rehashStep(Set *set);
+static bool growTable(Set *set);
 static void freeLLElement(LLElement *element);
-static size_t hashFunction(const char *key);
+static uint64_t hashStep(uint64_t hash, char c);
+static uint64_t hashFunction(const char *key, size_t *length);
 static char *duplicate_string(const char *str);
+static size_t filterSize(size_t tableSize);
+static uint64_t filterBits(uint64_t hash);
+static bool filterContains(const uint64_t *filter, size_t tableSize, uint64_t hash);
+static void filterAddPrefixes(uint64_t *filter, size_t tableSize, const char *key);
+static bool prefixMayExist(const Set *set, uint64_t hash);
+static Set *createWithSize(size_t tableSize);
+static bool addElement(Set *set, const char *key, size_t length, uint64_t hash);
+static size_t tableSizeFor(size_t nbKeys);
 
 /* static functions */
 
+/**
+ * @brief Find the node of a linked list that contains the key
+ *
+ * @param element          The start of the linked list
+ * @param key              A string of at least length characters
+ * @param length           The length of the key
+ * @param hash             The hash of the key
+ * @return LLElement*      The list node or NULL
+ */
+static LLElement *findInChain(LLElement *element, const char *key, size_t length, uint64_t hash)
+{
+    while (element != NULL)
+    {
+        // the hash is compared first, the key must then be exactly key[0..length[
+        if (element->hash == hash && strncmp(key, element->key, length) == 0 && element->key[length] == '\0')
+            return element;
+        element = element->next;
+    }
+    return NULL;
+}
+
 /**
  * @brief Find a pointer to the list node that contains the key or
  *        NULL if the key is not in the hash table.
  *
  * @param set              A pointer to a hash table
- * @param key              A valid string
+ * @param key              A string of at least length characters
+ * @param length           The length of the key
+ * @param hash             The hash of the key
  * @return LLElement*      The list node or NULL
  */
-static LLElement *findElement(const Set *set, const char *key)
+static LLElement *findElement(const Set *set, const char *key, size_t length, uint64_t hash)
 {
     if (!set)
         return NULL;
 
-    size_t index = hashFunction(key) % set->tableSize;
-    LLElement *element = set->table[index];
-    while (element != NULL)
+    LLElement *element = findInChain(set->table[bucketIndex(hash, set->tableSize)], key, length, hash);
+    if (!element && set->oldTable) // the key may not have been moved yet
+        element = findInChain(set->oldTable[bucketIndex(hash, set->oldTableSize)], key, length, hash);
+    return element;
+}
+
+/**
+ * @brief Return the bucket of a hash in a table
+ *
+ * @param hash             The hash of a key
+ * @param tableSize        The size of the table, a power of 2
+ * @return size_t
+ */
+static size_t bucketIndex(uint64_t hash, size_t tableSize)
+{
+    // fold the high bits, which depend on every character, into the low ones
+    return (size_t)(hash ^ (hash >> 32)) & (tableSize - 1);
+}
+
+/**
+ * @brief Move the next REHASH_STEP buckets of the previous table into the
+ *        current one (adding the prefixes of their keys to the current filter),
+ *        and release the previous table and filter once it is empty.
+ *
+ * @param set              A pointer to a hash table
+ */
+static void rehashStep(Set *set)
+{
+    for (size_t n = 0; n < REHASH_STEP && set->rehashIndex < set->oldTableSize; n++)
     {
-        if (strcmp(key, element->key) == 0)
-            return element;
-        element = element->next;
+        LLElement *element = set->oldTable[set->rehashIndex];
+        while (element != NULL)
+        {
+            LLElement *nextElement = element->next;
+            size_t index = bucketIndex(element->hash, set->tableSize);
+            element->next = set->table[index];
+            set->table[index] = element;
+            if (set->filter)
+                filterAddPrefixes(set->filter, set->tableSize, element->key);
+            element = nextElement;
+        }
+        set->oldTable[set->rehashIndex++] = NULL;
+    }
+
+    if (set->rehashIndex == set->oldTableSize)
+    {
+        free(set->oldTable);
+        free(set->oldFilter);
+        set->oldTable = NULL;
+        set->oldFilter = NULL;
+        set->oldTableSize = 0;
     }
-    return NULL;
+}
+
+/**
+ * @brief Replace the table (and its prefix filter) by an empty one twice as
+ *        large. The elements are moved later by rehashStep.
+ *
+ * @param set              A pointer to a hash table
+ * @return bool            false in case of allocation error
+ */
+static bool growTable(Set *set)
+{
+    // a previous resize must be over before starting another one
+    while (set->oldTable)
+        rehashStep(set);
+
+    LLElement **table = calloc(2 * set->tableSize, sizeof(LLElement *));
+    if (!table)
+        return false;
+
+    uint64_t *filter = NULL;
+    if (PREFIX_FILTER)
+    {
+        filter = calloc(filterSize(2 * set->tableSize), sizeof(uint64_t));
+        if (!filter)
+        {
+            free(table);
+            return false;
+        }
+    }
+
+    set->oldTable = set->table;
+    set->oldFilter = set->filter;
+    set->oldTableSize = set->tableSize;
+    set->rehashIndex = 0;
+    set->table = table;
+    set->filter = filter;
+    set->tableSize *= 2;
+    return true;
 }
 
 /**
@@ -76,22 +229,38 @@ static void freeLLElement(LLElement *element)
 }
 
 /**
- * @brief Computing an encoding (in base 26) of the key
+ * @brief Extend a hash by one character (64-bit FNV-1a). The hash of a string is
+ *        obtained by starting from FNV_OFFSET and adding its characters one at a
+ *        time, so that the hashes of all the prefixes of a string are computed in
+ *        a single pass. Unlike a base 26 encoding, every character keeps
+ *        influencing the whole hash whatever the length of the key.
+ *
+ * @param hash
+ * @param c
+ * @return uint64_t
+ */
+static uint64_t hashStep(uint64_t hash, char c)
+{
+    return (hash ^ (unsigned char)c) * FNV_PRIME;
+}
+
+/**
+ * @brief Computing the hash of the key
  *
  * @param key
- * @return size_t
+ * @param length      set to the length of the key
+ * @return uint64_t
  */
-static size_t hashFunction(const char *key)
+static uint64_t hashFunction(const char *key, size_t *length)
 {
-    size_t count = 0;
+    uint64_t hash = FNV_OFFSET;
+    size_t i = 0;
 
-    for (size_t i = 0; i < strlen(key); i++)
-    {
-        count *= 26;
-        count += key[i] - 'a';
-    }
+    for (; key[i] != '\0'; i++)
+        hash = hashStep(hash, key[i]);
 
-    return count;
+    *length = i;
+    return hash;
 }
 
 /**
@@ -109,30 +278,180 @@ static char *duplicate_string(const char *str)
     return copy;
 }
 
-/* header functions */
+/**
+ * @brief Return the number of 64-bit words of the prefix filter of a table
+ *
+ * @param tableSize   The size of the table, a power of 2
+ * @return size_t     A power of 2
+ */
+static size_t filterSize(size_t tableSize)
+{
+    return tableSize * FILTER_BITS_PER_BUCKET / 64;
+}
 
-Set *setCreateEmpty(void)
+/**
+ * @brief Return the FILTER_NB_PROBES bits of a hash within its filter word
+ *
+ * @param hash
+ * @return uint64_t
+ */
+static uint64_t filterBits(uint64_t hash)
+{
+    // scramble the bits first, the word index uses the low ones
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    uint64_t bits = 0;
+    for (int i = 0; i < FILTER_NB_PROBES; i++)
+        bits |= (uint64_t)1 << ((hash >> (64 - 6 * (i + 1))) & 63);
+    return bits;
+}
+
+/**
+ * @brief Return true if a hash may have been added to a filter, false if it
+ *        was certainly not.
+ *
+ * @param filter      A prefix filter
+ * @param tableSize   The size of the table of the filter
+ * @param hash        The hash of a prefix
+ * @return bool
+ */
+static bool filterContains(const uint64_t *filter, size_t tableSize, uint64_t hash)
+{
+    uint64_t bits = filterBits(hash);
+    return (filter[bucketIndex(hash, filterSize(tableSize))] & bits) == bits;
+}
+
+/**
+ * @brief Add the hashes of the proper prefixes of a key to a filter
+ *
+ * @param filter      A prefix filter
+ * @param tableSize   The size of the table of the filter
+ * @param key         The key
+ */
+static void filterAddPrefixes(uint64_t *filter, size_t tableSize, const char *key)
+{
+    size_t nbWords = filterSize(tableSize);
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; key[i] != '\0' && key[i + 1] != '\0'; i++)
+    {
+        hash = hashStep(hash, key[i]);
+        filter[bucketIndex(hash, nbWords)] |= filterBits(hash);
+    }
+}
+
+/**
+ * @brief Return false if no key can start with the string of the given hash
+ *        followed by at least one character.
+ *
+ * @param set         A pointer to a hash table
+ * @param hash        The hash of a string
+ * @return bool
+ */
+static bool prefixMayExist(const Set *set, uint64_t hash)
+{
+    if (!PREFIX_FILTER)
+        return true;
+    return filterContains(set->filter, set->tableSize, hash) ||
+           (set->oldFilter && filterContains(set->oldFilter, set->oldTableSize, hash));
+}
+
+/**
+ * @brief Create an empty hash table with a table of the given size
+ *
+ * @param tableSize   The size of the table, a power of 2
+ * @return Set*       A pointer to the hash table, NULL in case of allocation error
+ */
+static Set *createWithSize(size_t tableSize)
 {
     Set *res = malloc(sizeof(Set));
     if (!res)
         return NULL;
 
-    res->tableSize = INIT_CAPACITY;
+    res->tableSize = tableSize;
+    res->oldTable = NULL;
+    res->oldTableSize = 0;
+    res->rehashIndex = 0;
     res->numElements = 0;
-
-    res->table = malloc(sizeof(LLElement *) * res->tableSize);
-    if (!res->table)
+    res->maxKeyLength = 0;
+    res->keyBytes = 0;
+    res->filter = NULL;
+    res->oldFilter = NULL;
+
+    res->table = calloc(res->tableSize, sizeof(LLElement *));
+    if (PREFIX_FILTER)
+        res->filter = calloc(filterSize(res->tableSize), sizeof(uint64_t));
+    if (!res->table || (PREFIX_FILTER && !res->filter))
     {
+        free(res->table);
+        free(res->filter);
         free(res);
         return NULL;
     }
 
-    for (size_t i = 0; i < res->tableSize; ++i)
-        res->table[i] = NULL;
-
     return res;
 }
 
+/**
+ * @brief Add a key that is not in the table yet, without growing the table.
+ *
+ * @param set         A pointer to a hash table
+ * @param key         The key
+ * @param length      The length of the key
+ * @param hash        The hash of the key
+ * @return bool       false in case of allocation error
+ */
+static bool addElement(Set *set, const char *key, size_t length, uint64_t hash)
+{
+    LLElement *element = malloc(sizeof(LLElement));
+    if (!element)
+        return false;
+
+    element->key = duplicate_string(key);
+    if (!element->key)
+    {
+        free(element);
+        return false;
+    }
+
+    if (PREFIX_FILTER)
+        filterAddPrefixes(set->filter, set->tableSize, key);
+
+    size_t index = bucketIndex(hash, set->tableSize);
+    element->hash = hash;
+    element->next = set->table[index];
+    set->table[index] = element;
+    set->numElements++;
+    set->keyBytes += length + 1;
+
+    if (length > set->maxKeyLength)
+        set->maxKeyLength = length;
+
+    return true;
+}
+
+/**
+ * @brief Return the size of a table holding a number of keys without growing
+ *
+ * @param nbKeys      The number of keys
+ * @return size_t     A power of 2, at least INIT_CAPACITY
+ */
+static size_t tableSizeFor(size_t nbKeys)
+{
+    size_t tableSize = INIT_CAPACITY;
+    while (MAX_LOAD_FACTOR * tableSize < nbKeys)
+        tableSize *= 2;
+    return tableSize;
+}
+
+/* header functions */
+
+Set *setCreateEmpty(void)
+{
+    return createWithSize(INIT_CAPACITY);
+}
+
 void setFree(Set *set)
 {
     if (!set)
@@ -140,8 +459,13 @@ void setFree(Set *set)
 
     for (size_t i = 0; i < set->tableSize; ++i)
         freeLLElement(set->table[i]);
+    for (size_t i = set->rehashIndex; i < set->oldTableSize; ++i)
+        freeLLElement(set->oldTable[i]);
 
     free(set->table);
+    free(set->oldTable);
+    free(set->filter);
+    free(set->oldFilter);
     free(set);
 }
 
@@ -150,28 +474,37 @@ int setInsert(Set *set, const char *key)
     if (!set)
         return -1;
 
-    size_t index = hashFunction(key) % set->tableSize;
+    size_t length;
+    uint64_t hash = hashFunction(key, &length);
 
-    LLElement *element = set->table[index];
-    while (element != NULL)
-    {
-        if (strcmp(key, element->key) == 0)
-        {
-            return 0;
-        }
-        element = element->next;
-    }
+    if (findElement(set, key, length, hash))
+        return 0;
 
-    element = malloc(sizeof(LLElement));
-    if (!element)
+    if (set->oldTable)
+        rehashStep(set);
+    if (set->numElements >= MAX_LOAD_FACTOR * set->tableSize && !growTable(set))
         return -1;
 
-    element->key = duplicate_string(key);
-    element->next = set->table[index];
-    set->table[index] = element;
-    set->numElements++;
+    return addElement(set, key, length, hash) ? 1 : -1;
+}
 
-    return 1;
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys)
+{
+    // the order of the keys does not matter here: the table is created at its
+    // final size, so it never grows nor rehashes, and duplicates are found by
+    // the search that precedes each addition
+    Set *set = createWithSize(tableSizeFor(nbKeys));
+    for (size_t i = 0; set && i < nbKeys; i++)
+    {
+        size_t length;
+        uint64_t hash = hashFunction(keys[i], &length);
+        if (!findElement(set, keys[i], length, hash) && !addElement(set, keys[i], length, hash))
+        {
+            setFree(set);
+            set = NULL;
+        }
+    }
+    return set;
 }
 
 size_t setNbKeys(const Set *set)
@@ -181,30 +514,59 @@ size_t setNbKeys(const Set *set)
     return set->numElements;
 }
 
+size_t setMemoryUsage(const Set *set)
+{
+    if (!set)
+        return 0;
+
+    size_t bytes = sizeof(Set) + (set->tableSize + set->oldTableSize) * sizeof(LLElement *);
+    bytes += set->numElements * sizeof(LLElement) + set->keyBytes;
+
+    // the prefix filters: 256 KiB of the 5.3 MiB used for english.txt
+    if (set->filter)
+        bytes += filterSize(set->tableSize) * sizeof(uint64_t);
+    if (set->oldFilter)
+        bytes += filterSize(set->oldTableSize) * sizeof(uint64_t);
+
+    return bytes;
+}
+
 bool setContains(const Set *set, const char *key)
 {
-    return findElement(set, key) ? true : false;
+    size_t length;
+    uint64_t hash = hashFunction(key, &length);
+    return findElement(set, key, length, hash) ? true : false;
 }
 
 
 /* student code starts here */
 
 /* Prototypes */
-static bool isPrefix(const char *str, const char *word);
+static bool addPrefixToList(const char *key, size_t length, void *list);
 /* static functions */
 
 /**
- * @brief Checks if a given word is a prefix of a string
+ * @brief SetVisitor appending a copy of each key to a list
  *
- * @param str a string
- * @param word the word to be checked
+ * @param key the key found
+ * @param length the length of key
+ * @param list a pointer to a List
  * 
- * @return bool : true if word is a prefix of str
- *                false otherwise
+ * @return bool : true if the key was added
+ *                false in case of allocation error
  */
-static bool isPrefix(const char *str, const char *word){
+static bool addPrefixToList(const char *key, size_t length, void *list){
+    char *copy = malloc(length + 1);
+    if (!copy)
+        return false;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
 
-    return strncmp(str, word, strlen(word)) == 0;
+    if (!listInsertLast(list, copy)){
+        free(copy);
+        return false;
+    }
+    return true;
 }
 
 List *setGetAllStringPrefixes(const Set *set, const char *str)
@@ -214,35 +576,156 @@ List *setGetAllStringPrefixes(const Set *set, const char *str)
         return NULL;
     }
 
-    size_t strSize = strlen(str);
+    if (!setVisitAllStringPrefixes(set, str, addPrefixToList, foundPrefixes)){
+        listFree(foundPrefixes, true);
+        return NULL;
+    }
+    return foundPrefixes;
+}
 
-    LLElement *element = set->table[0];
-    
-    size_t count = 0;
-    for (size_t i = 0; i < strSize ; i++){
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context)
+{
+    uint64_t hash = FNV_OFFSET;
+    // no key is longer than maxKeyLength
+    for (size_t i = 0; str[i] != '\0' && i < set->maxKeyLength; i++){
         // same strategy as hashFunction
-        count *= 26;
-        count += str[i] - 'a';
-        element = set->table[count % set->tableSize];
-
-        while (element != NULL){
-
-            if (isPrefix(str, element->key)){
-                
-                char *copy = duplicate_string(element->key);
-                if (!copy){
-                    listFree(foundPrefixes, true);
-                    return NULL;
-                }
-
-                if (!listInsertLast(foundPrefixes, copy)){
-                    free(copy);
-                    listFree(foundPrefixes, true);
-                    return NULL;
-                }
-            }
-            element = element->next;
+        hash = hashStep(hash, str[i]);
+
+        LLElement *element = findElement(set, str, i + 1, hash);
+        if (element && !visit(element->key, i + 1, context))
+            return false;
+
+        if (!prefixMayExist(set, hash)) // no key starts with str[0..i]
+            break;
+    }
+    return true;
+}
+
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context)
+{
+    for (size_t i = 0; i < set->tableSize; i++)
+    {
+        for (const LLElement *e = set->table[i]; e; e = e->next)
+        {
+            if (!visit(e->key, strlen(e->key), context))
+                return false;
         }
     }
-    return foundPrefixes;
+    for (size_t i = set->rehashIndex; i < set->oldTableSize; i++)
+    {
+        for (const LLElement *e = set->oldTable[i]; e; e = e->next)
+        {
+            if (!visit(e->key, strlen(e->key), context))
+                return false;
+        }
+    }
+    return true;
+}
+
+/* Snapshot */
+
+bool setSave(const Set *set, const char *filename)
+{
+    SnapshotKeys keys = {NULL, 0, 0};
+    bool ok = setVisitAllKeys(set, snapshotKeysAdd, &keys);
+
+    SnapshotSection section = {keys.data, keys.size};
+    ok = ok && snapshotWrite(filename, "HashTable", &section, 1);
+    free(keys.data);
+    return ok;
+}
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "HashTable");
+    if (!snapshot)
+        return NULL;
+
+    // elements hold their own copy of the keys: the table is rebuilt from the
+    // snapshot, at its final size since the keys are known to be distinct
+    size_t nbKeys;
+    const char **keys = snapshotKeys(snapshot, &nbKeys);
+    Set *set = keys ? createWithSize(tableSizeFor(nbKeys)) : NULL;
+    for (size_t i = 0; set && i < nbKeys; i++)
+    {
+        size_t length;
+        uint64_t hash = hashFunction(keys[i], &length);
+        if (!addElement(set, keys[i], length, hash))
+        {
+            setFree(set);
+            set = NULL;
+        }
+    }
+
+    free(keys);
+    snapshotClose(snapshot);
+    return set;
+}
+
+/* Cursor */
+
+struct SetCursor_t
+{
+    const Set *set;
+    char *buffer; // string read so far, of at most maxKeyLength characters
+    size_t length;
+    uint64_t hash; // hash of buffer, updated one character at a time
+    bool dead;
+};
+
+SetCursor *setCursorCreate(const Set *set)
+{
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->buffer = malloc(set->maxKeyLength + 1);
+    if (!cursor->buffer){
+        free(cursor);
+        return NULL;
+    }
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}
+
+void setCursorFree(SetCursor *cursor)
+{
+    if (!cursor)
+        return;
+    free(cursor->buffer);
+    free(cursor);
+}
+
+void setCursorReset(SetCursor *cursor)
+{
+    cursor->buffer[0] = '\0';
+    cursor->length = 0;
+    cursor->hash = FNV_OFFSET;
+    cursor->dead = false;
+}
+
+int setCursorStep(SetCursor *cursor, char c)
+{
+    if (cursor->dead || cursor->length == cursor->set->maxKeyLength){
+        cursor->dead = true;
+        return 0;
+    }
+
+    cursor->buffer[cursor->length++] = c;
+    cursor->buffer[cursor->length] = '\0';
+
+    // same strategy as hashFunction
+    cursor->hash = hashStep(cursor->hash, c);
+
+    int flags = 0;
+    if (cursor->length < cursor->set->maxKeyLength && prefixMayExist(cursor->set, cursor->hash))
+        flags |= SET_CURSOR_PREFIX;
+    if (findElement(cursor->set, cursor->buffer, cursor->length, cursor->hash))
+        flags |= SET_CURSOR_KEY;
+
+    cursor->dead = (flags == 0);
+    return flags;
 }
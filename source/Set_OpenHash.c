@@ -0,0 +1,740 @@
+/* ========================================================================= *
+ * OpenHash
+ *
+ * Implementation of Set.h based on an open-addressing hash table with
+ * linear probing. Each slot stores the hash and the length of its key next
+ * to the offset of the key in a single string pool, so that a probe only
+ * reads the key bytes when both already match.
+ *
+ * The hashes of all the proper prefixes of the keys are also recorded in a
+ * blocked Bloom filter (all the bits of a hash lie in the same 64-bit word),
+ * so that a prefix search stops as soon as the string read so far cannot be
+ * extended into a key. The filter never misses a prefix but may report a few
+ * false ones. It is sized with the table and refilled when the table grows.
+ *
+ * Slots locate keys by offset, not by address, so a snapshot holds the table,
+ * the filter and the pool as they are, and setOpen uses them from the mapped
+ * file once they have been checked. They are copied in memory by the first
+ * insertion.
+ *
+ * ========================================================================= */
+
+#include "Set.h"
+#include "Snapshot.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INIT_CAPACITY 16 // must be a power of 2
+#define INIT_POOL_SIZE 256
+#define HASH_MULTIPLIER 0x100000001b3ULL
+
+#define FILTER_BITS_PER_SLOT 16 // keys have about 1.5 distinct proper prefixes each
+#define FILTER_NB_PROBES 4
+
+/* Structures */
+
+typedef struct Slot_t
+{
+    uint64_t hash;   // rolling hash of the key (see hashStep)
+    size_t length;   // length of the key, 0 for an empty slot
+    size_t offset;   // offset of the key in the pool
+} Slot;
+
+struct Set_t
+{
+    Slot *table;
+    size_t capacity; // number of slots, a power of 2
+    uint64_t *filter; // prefix filter, of filterSize(capacity) words
+    size_t numElements;
+    size_t maxKeyLength;
+    bool hasEmptyKey; // "" cannot be stored in a slot
+    char *pool;       // all keys, each followed by a \0
+    size_t poolSize;
+    size_t poolCapacity;
+    Snapshot *snapshot; // the file holding table, filter and pool if they are mapped, NULL otherwise
+};
+
+/* Layout of the snapshot files */
+
+#define SECTION_HEADER 1
+#define SECTION_TABLE 2
+#define SECTION_FILTER 3
+
+typedef struct SnapshotHeader_t
+{
+    uint64_t capacity;
+    uint64_t numElements;
+    uint64_t maxKeyLength;
+    uint64_t hasEmptyKey;
+} SnapshotHeader;
+
+/* Prototypes */
+
+static uint64_t hashStep(uint64_t hash, char c);
+static uint64_t mixHash(uint64_t hash);
+static size_t slotIndex(const Set *set, uint64_t hash);
+static size_t filterSize(size_t capacity);
+static bool filterContains(const Set *set, uint64_t hash);
+static void filterAddPrefixes(uint64_t *filter, size_t capacity, const char *key, size_t length);
+static const Slot *findSlot(const Set *set, const char *key, size_t length, uint64_t hash);
+static bool growTable(Set *set);
+static bool poolAppend(Set *set, const char *key, size_t length, size_t *offset);
+static bool detach(Set *set);
+static Set *createWithSize(size_t capacity, size_t poolCapacity);
+static bool checkSnapshot(const SnapshotHeader *header, const Slot *table, size_t tableSize,
+                          size_t filterBytes, const char *pool, size_t poolSize);
+static bool addPrefixToList(const char *key, size_t length, void *list);
+
+/* static functions */
+
+/**
+ * @brief Extends a hash by one character. The hash of a string is obtained by
+ *        starting from 0 and adding its characters one at a time, so that the
+ *        hashes of all the prefixes of a string are computed in a single pass.
+ *
+ * @param hash     The hash of a string
+ * @param c        The next character
+ * @return uint64_t The hash of the string followed by c
+ */
+static uint64_t hashStep(uint64_t hash, char c)
+{
+    return hash * HASH_MULTIPLIER + (unsigned char)c;
+}
+
+/**
+ * @brief Mix the bits of a rolling hash. Its low bits only depend on the low
+ *        bits of the characters, so they are mixed with the high bits before
+ *        being used as an index.
+ *
+ * @param hash      The hash of a string
+ * @return uint64_t
+ */
+static uint64_t mixHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Return the first slot to probe for a hash
+ *
+ * @param set      A pointer to a set
+ * @param hash     The hash of a key
+ * @return size_t  An index in the table
+ */
+static size_t slotIndex(const Set *set, uint64_t hash)
+{
+    return (size_t)mixHash(hash) & (set->capacity - 1);
+}
+
+/**
+ * @brief Return the number of 64-bit words of the prefix filter of a table
+ *
+ * @param capacity  The number of slots, a power of 2 of at least 4
+ * @return size_t   A power of 2
+ */
+static size_t filterSize(size_t capacity)
+{
+    return capacity * FILTER_BITS_PER_SLOT / 64;
+}
+
+/**
+ * @brief Set the word index and the FILTER_NB_PROBES bits of a hash in a filter.
+ *        The index uses the low bits of the mixed hash, the probes the high ones.
+ *
+ * @param hash      The hash of a prefix
+ * @param nbWords   The size of the filter, a power of 2
+ * @param word      Set to the index of the word holding the bits
+ * @return uint64_t The bits
+ */
+static uint64_t filterBits(uint64_t hash, size_t nbWords, size_t *word)
+{
+    hash = mixHash(hash);
+    *word = (size_t)hash & (nbWords - 1);
+
+    uint64_t bits = 0;
+    for (int i = 0; i < FILTER_NB_PROBES; i++)
+        bits |= (uint64_t)1 << ((hash >> (64 - 6 * (i + 1))) & 63);
+    return bits;
+}
+
+/**
+ * @brief Return false if no key can start with the string of the given hash
+ *        followed by at least one character.
+ *
+ * @param set      A pointer to a set
+ * @param hash     The hash of a string
+ * @return bool
+ */
+static bool filterContains(const Set *set, uint64_t hash)
+{
+    size_t word;
+    uint64_t bits = filterBits(hash, filterSize(set->capacity), &word);
+    return (set->filter[word] & bits) == bits;
+}
+
+/**
+ * @brief Add the hashes of the proper prefixes of a key to a filter
+ *
+ * @param filter    A prefix filter
+ * @param capacity  The number of slots of the table of the filter
+ * @param key       The key
+ * @param length    The length of the key
+ */
+static void filterAddPrefixes(uint64_t *filter, size_t capacity, const char *key, size_t length)
+{
+    size_t nbWords = filterSize(capacity);
+    uint64_t hash = 0;
+    for (size_t i = 0; i + 1 < length; i++)
+    {
+        hash = hashStep(hash, key[i]);
+        size_t word;
+        uint64_t bits = filterBits(hash, nbWords, &word);
+        filter[word] |= bits;
+    }
+}
+
+/**
+ * @brief Find the slot of a key, or the empty slot where it would be inserted.
+ *
+ * @param set      A pointer to a set
+ * @param key      The key (not necessarily followed by a \0)
+ * @param length   The length of the key, at least 1
+ * @param hash     The hash of the key
+ * @return const Slot* The slot holding the key, or an empty slot
+ */
+static const Slot *findSlot(const Set *set, const char *key, size_t length, uint64_t hash)
+{
+    size_t mask = set->capacity - 1;
+    size_t index = slotIndex(set, hash);
+    const Slot *slot = &set->table[index];
+
+    while (slot->length != 0)
+    {
+        if (slot->hash == hash && slot->length == length &&
+            memcmp(set->pool + slot->offset, key, length) == 0)
+            return slot;
+
+        index = (index + 1) & mask;
+        slot = &set->table[index];
+    }
+    return slot;
+}
+
+/**
+ * @brief Double the number of slots. Keys are moved using their stored hash,
+ *        without reading them, but the larger filter is refilled from the keys.
+ *
+ * @param set      A pointer to a set
+ * @return bool    false in case of allocation error
+ */
+static bool growTable(Set *set)
+{
+    Slot *oldTable = set->table;
+    size_t oldCapacity = set->capacity;
+
+    Slot *table = calloc(2 * oldCapacity, sizeof(Slot));
+    uint64_t *filter = calloc(filterSize(2 * oldCapacity), sizeof(uint64_t));
+    if (!table || !filter)
+    {
+        free(table);
+        free(filter);
+        return false;
+    }
+
+    set->table = table;
+    set->capacity = 2 * oldCapacity;
+    size_t mask = set->capacity - 1;
+
+    for (size_t i = 0; i < oldCapacity; i++)
+    {
+        if (oldTable[i].length == 0)
+            continue;
+
+        size_t index = slotIndex(set, oldTable[i].hash);
+        while (table[index].length != 0)
+            index = (index + 1) & mask;
+        table[index] = oldTable[i];
+        filterAddPrefixes(filter, set->capacity, set->pool + oldTable[i].offset, oldTable[i].length);
+    }
+
+    free(oldTable);
+    free(set->filter);
+    set->filter = filter;
+    return true;
+}
+
+/**
+ * @brief Copy a key at the end of the pool
+ *
+ * @param set      A pointer to a set
+ * @param key      The key
+ * @param length   The length of the key
+ * @param offset   Set to the offset of the copy in the pool
+ * @return bool    false in case of allocation error
+ */
+static bool poolAppend(Set *set, const char *key, size_t length, size_t *offset)
+{
+    if (set->poolSize + length + 1 > set->poolCapacity)
+    {
+        size_t capacity = 2 * set->poolCapacity;
+        while (set->poolSize + length + 1 > capacity)
+            capacity *= 2;
+
+        char *pool = realloc(set->pool, capacity);
+        if (!pool)
+            return false;
+        set->pool = pool;
+        set->poolCapacity = capacity;
+    }
+
+    *offset = set->poolSize;
+    memcpy(set->pool + set->poolSize, key, length + 1);
+    set->poolSize += length + 1;
+    return true;
+}
+
+/**
+ * @brief Copy in memory the table, the filter and the pool of a set opened
+ *        from a snapshot, so that it can be modified
+ *
+ * @param set      A pointer to a set
+ * @return bool    false in case of allocation error
+ */
+static bool detach(Set *set)
+{
+    if (!set->snapshot)
+        return true;
+
+    Slot *table = malloc(set->capacity * sizeof(Slot));
+    uint64_t *filter = malloc(filterSize(set->capacity) * sizeof(uint64_t));
+    char *pool = malloc(set->poolCapacity);
+    if (!table || !filter || !pool)
+    {
+        free(table);
+        free(filter);
+        free(pool);
+        return false;
+    }
+    memcpy(table, set->table, set->capacity * sizeof(Slot));
+    memcpy(filter, set->filter, filterSize(set->capacity) * sizeof(uint64_t));
+    memcpy(pool, set->pool, set->poolSize);
+
+    set->table = table;
+    set->filter = filter;
+    set->pool = pool;
+    snapshotClose(set->snapshot);
+    set->snapshot = NULL;
+    return true;
+}
+
+/**
+ * @brief SetVisitor appending a copy of each key to a list
+ *
+ * @param key      The key found
+ * @param length   The length of key
+ * @param list     A pointer to a List
+ * @return bool    false in case of allocation error
+ */
+static bool addPrefixToList(const char *key, size_t length, void *list)
+{
+    char *copy = malloc(length + 1);
+    if (!copy)
+        return false;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+
+    if (!listInsertLast(list, copy))
+    {
+        free(copy);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Create an empty set with the given number of slots and pool size
+ *
+ * @param capacity      The number of slots, a power of 2
+ * @param poolCapacity  The size of the pool, at least 1
+ * @return Set*         A pointer to the set, NULL in case of allocation error
+ */
+static Set *createWithSize(size_t capacity, size_t poolCapacity)
+{
+    Set *res = malloc(sizeof(Set));
+    if (!res)
+        return NULL;
+
+    res->capacity = capacity;
+    res->numElements = 0;
+    res->maxKeyLength = 0;
+    res->hasEmptyKey = false;
+    res->poolSize = 0;
+    res->poolCapacity = poolCapacity;
+    res->snapshot = NULL;
+
+    res->table = calloc(res->capacity, sizeof(Slot));
+    res->filter = calloc(filterSize(res->capacity), sizeof(uint64_t));
+    res->pool = malloc(res->poolCapacity);
+    if (!res->table || !res->filter || !res->pool)
+    {
+        free(res->table);
+        free(res->filter);
+        free(res->pool);
+        free(res);
+        return NULL;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Check that the sections of a snapshot describe a valid table, so that
+ *        no probe or key read can leave them: the capacity is a power of 2
+ *        matching the table and filter sizes, at least one slot is empty, every
+ *        key lies in the pool and is followed by a \0, and the counts agree.
+ *
+ * @param header       The header section
+ * @param table        The table section
+ * @param tableSize    The size of the table section in bytes
+ * @param filterBytes  The size of the filter section in bytes
+ * @param pool         The keys section
+ * @param poolSize     The size of the keys section in bytes
+ * @return bool        true if the snapshot can be used as it is
+ */
+static bool checkSnapshot(const SnapshotHeader *header, const Slot *table, size_t tableSize,
+                          size_t filterBytes, const char *pool, size_t poolSize)
+{
+    uint64_t capacity = header->capacity;
+    if (capacity < INIT_CAPACITY || (capacity & (capacity - 1)) != 0 ||
+        capacity > SIZE_MAX / sizeof(Slot) || tableSize != capacity * sizeof(Slot) ||
+        filterBytes != filterSize(capacity) * sizeof(uint64_t))
+        return false;
+
+    if (header->hasEmptyKey > 1 || header->numElements < header->hasEmptyKey ||
+        header->numElements - header->hasEmptyKey >= capacity)
+        return false;
+
+    // the pool is followed by a \0 for the empty key, and every key ends with one
+    if (poolSize < header->hasEmptyKey || (poolSize > 0 && pool[poolSize - 1] != '\0'))
+        return false;
+    size_t keysSize = poolSize - header->hasEmptyKey;
+
+    uint64_t nbSlots = 0;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        const Slot *slot = &table[i];
+        if (slot->length == 0)
+            continue;
+        if (slot->length > header->maxKeyLength || slot->offset >= keysSize ||
+            slot->length > keysSize - slot->offset - 1 || pool[slot->offset + slot->length] != '\0')
+            return false;
+        nbSlots++;
+    }
+    return nbSlots == header->numElements - header->hasEmptyKey;
+}
+
+/* header functions */
+
+Set *setCreateEmpty(void)
+{
+    return createWithSize(INIT_CAPACITY, INIT_POOL_SIZE);
+}
+
+void setFree(Set *set)
+{
+    if (!set)
+        return;
+
+    if (set->snapshot)
+        snapshotClose(set->snapshot);
+    else
+    {
+        free(set->table);
+        free(set->filter);
+        free(set->pool);
+    }
+    free(set);
+}
+
+size_t setNbKeys(const Set *set)
+{
+    if (!set)
+        return (size_t)-1;
+    return set->numElements;
+}
+
+size_t setMemoryUsage(const Set *set)
+{
+    if (!set)
+        return 0;
+
+    // the prefix filter: 512 KiB of the 8.5 MiB used for english.txt
+    return sizeof(Set) + set->capacity * sizeof(Slot) +
+           filterSize(set->capacity) * sizeof(uint64_t) + set->poolCapacity;
+}
+
+bool setContains(const Set *set, const char *key)
+{
+    if (!set)
+        return false;
+
+    if (key[0] == '\0')
+        return set->hasEmptyKey;
+
+    uint64_t hash = 0;
+    size_t length = 0;
+    for (; key[length] != '\0'; length++)
+        hash = hashStep(hash, key[length]);
+
+    return findSlot(set, key, length, hash)->length != 0;
+}
+
+int setInsert(Set *set, const char *key)
+{
+    if (!set)
+        return -1;
+
+    if (key[0] == '\0')
+    {
+        if (set->hasEmptyKey)
+            return 0;
+        if (!detach(set))
+            return -1;
+        set->hasEmptyKey = true;
+        set->numElements++;
+        return 1;
+    }
+
+    uint64_t hash = 0;
+    size_t length = 0;
+    for (; key[length] != '\0'; length++)
+        hash = hashStep(hash, key[length]);
+
+    if (findSlot(set, key, length, hash)->length != 0)
+        return 0;
+
+    if (!detach(set))
+        return -1;
+
+    // keep the load factor below 3/4
+    if (4 * (set->numElements + 1) > 3 * set->capacity && !growTable(set))
+        return -1;
+
+    size_t offset;
+    if (!poolAppend(set, key, length, &offset))
+        return -1;
+
+    Slot *slot = (Slot *)findSlot(set, key, length, hash);
+    slot->hash = hash;
+    slot->length = length;
+    slot->offset = offset;
+    filterAddPrefixes(set->filter, set->capacity, key, length);
+
+    set->numElements++;
+    if (length > set->maxKeyLength)
+        set->maxKeyLength = length;
+
+    return 1;
+}
+
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys)
+{
+    // the order of the keys does not matter here: table and pool are allocated
+    // at their final size, so that the insertions never grow them
+    size_t capacity = INIT_CAPACITY;
+    while (4 * nbKeys > 3 * capacity)
+        capacity *= 2;
+    size_t poolCapacity = 1;
+    for (size_t i = 0; i < nbKeys; i++)
+        poolCapacity += strlen(keys[i]) + 1;
+
+    Set *set = createWithSize(capacity, poolCapacity);
+    for (size_t i = 0; set && i < nbKeys; i++)
+    {
+        if (setInsert(set, keys[i]) < 0)
+        {
+            setFree(set);
+            set = NULL;
+        }
+    }
+    return set;
+}
+
+List *setGetAllStringPrefixes(const Set *set, const char *str)
+{
+    List *foundPrefixes = listNew();
+    if (!foundPrefixes)
+        return NULL;
+
+    if (!setVisitAllStringPrefixes(set, str, addPrefixToList, foundPrefixes))
+    {
+        listFree(foundPrefixes, true);
+        return NULL;
+    }
+    return foundPrefixes;
+}
+
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context)
+{
+    uint64_t hash = 0;
+    // no key is longer than maxKeyLength
+    for (size_t i = 0; str[i] != '\0' && i < set->maxKeyLength; i++)
+    {
+        hash = hashStep(hash, str[i]);
+
+        const Slot *slot = findSlot(set, str, i + 1, hash);
+        if (slot->length != 0 && !visit(set->pool + slot->offset, i + 1, context))
+            return false;
+
+        if (!filterContains(set, hash)) // no key starts with str[0..i]
+            break;
+    }
+    return true;
+}
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context)
+{
+    // the pool holds every key but the empty one, in insertion order
+    if (set->hasEmptyKey && !visit("", 0, context))
+        return false;
+    for (size_t offset = 0; offset < set->poolSize;)
+    {
+        size_t length = strlen(set->pool + offset);
+        if (!visit(set->pool + offset, length, context))
+            return false;
+        offset += length + 1;
+    }
+    return true;
+}
+
+/* Snapshot */
+
+bool setSave(const Set *set, const char *filename)
+{
+    SnapshotHeader header = {set->capacity, set->numElements, set->maxKeyLength, set->hasEmptyKey};
+
+    // the keys section is the pool itself, plus the empty key which has no slot
+    char *keys = NULL;
+    if (set->hasEmptyKey)
+    {
+        keys = malloc(set->poolSize + 1);
+        if (!keys)
+            return false;
+        memcpy(keys, set->pool, set->poolSize);
+        keys[set->poolSize] = '\0';
+    }
+
+    SnapshotSection sections[] = {
+        {keys ? keys : set->pool, set->poolSize + (keys ? 1 : 0)},
+        {&header, sizeof(SnapshotHeader)},
+        {set->table, set->capacity * sizeof(Slot)},
+        {set->filter, filterSize(set->capacity) * sizeof(uint64_t)},
+    };
+    bool ok = snapshotWrite(filename, "OpenHash", sections, 4);
+    free(keys);
+    return ok;
+}
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "OpenHash");
+    if (!snapshot)
+        return NULL;
+
+    size_t poolSize, headerSize, tableSize, filterBytes;
+    const char *pool = snapshotSection(snapshot, SNAPSHOT_KEYS, &poolSize);
+    const SnapshotHeader *header = snapshotSection(snapshot, SECTION_HEADER, &headerSize);
+    const Slot *table = snapshotSection(snapshot, SECTION_TABLE, &tableSize);
+    const uint64_t *filter = snapshotSection(snapshot, SECTION_FILTER, &filterBytes);
+
+    Set *set = malloc(sizeof(Set));
+    if (!set || !pool || !header || !table || !filter || headerSize != sizeof(SnapshotHeader) ||
+        !checkSnapshot(header, table, tableSize, filterBytes, pool, poolSize))
+    {
+        free(set);
+        snapshotClose(snapshot);
+        return NULL;
+    }
+
+    // they are only read until detach copies them
+    set->table = (Slot *)table;
+    set->filter = (uint64_t *)filter;
+    set->pool = (char *)pool;
+    set->capacity = header->capacity;
+    set->numElements = header->numElements;
+    set->maxKeyLength = header->maxKeyLength;
+    set->hasEmptyKey = header->hasEmptyKey;
+    set->poolSize = poolSize - (set->hasEmptyKey ? 1 : 0);
+    set->poolCapacity = set->poolSize > 0 ? set->poolSize : 1;
+    set->snapshot = snapshot;
+    return set;
+}
+
+/* Cursor */
+
+struct SetCursor_t
+{
+    const Set *set;
+    char *buffer; // string read so far, of at most maxKeyLength characters
+    size_t length;
+    uint64_t hash; // hash of buffer
+    bool dead;
+};
+
+SetCursor *setCursorCreate(const Set *set)
+{
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->buffer = malloc(set->maxKeyLength + 1);
+    if (!cursor->buffer)
+    {
+        free(cursor);
+        return NULL;
+    }
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}
+
+void setCursorFree(SetCursor *cursor)
+{
+    if (!cursor)
+        return;
+    free(cursor->buffer);
+    free(cursor);
+}
+
+void setCursorReset(SetCursor *cursor)
+{
+    cursor->length = 0;
+    cursor->hash = 0;
+    cursor->dead = false;
+}
+
+int setCursorStep(SetCursor *cursor, char c)
+{
+    if (cursor->dead || cursor->length == cursor->set->maxKeyLength)
+    {
+        cursor->dead = true;
+        return 0;
+    }
+
+    cursor->buffer[cursor->length++] = c;
+    cursor->hash = hashStep(cursor->hash, c);
+
+    int flags = 0;
+    if (cursor->length < cursor->set->maxKeyLength && filterContains(cursor->set, cursor->hash))
+        flags |= SET_CURSOR_PREFIX;
+    if (findSlot(cursor->set, cursor->buffer, cursor->length, cursor->hash)->length != 0)
+        flags |= SET_CURSOR_KEY;
+
+    cursor->dead = (flags == 0);
+    return flags;
+}
@@ -1,362 +1,488 @@
 #include "Set.h"
+#include "Snapshot.h"
+#include "SortedKeys.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 /* STRUCTURES */
 
 typedef struct RNode_t RNode;
-typedef struct Edge_t Edge;
-typedef struct EList_t EdgeList;
 
-struct Edge_t // Edge 
-{
-    char *label;
-    RNode *targetNode;
-    struct Edge_t *next;
-};
-
-struct EList_t  // list of edges (inspired by linked list)
+/*
+ * A node is a single allocation holding the label of the edge that leads to
+ * it. Its children are kept in one block: `capacity` pointers followed by the
+ * first byte of each child label, sorted, so that finding the child to follow
+ * only reads that small byte array (see findChild). Keys are not stored:
+ * a node is terminal when the path from the root to it spells a key.
+ */
+struct RNode_t // radix node
 {
-    size_t size;
-    Edge *head;
-    Edge *last;
+    RNode **children;    // capacity pointers then capacity first bytes, NULL if capacity is 0
+    uint16_t nbChildren;
+    uint16_t capacity;
+    bool terminal;       // a key ends at this node
+    size_t labelLength;
+    char label[];        // label of the edge leading to the node (not \0-terminated)
 };
 
-struct RNode_t // radix node
+/*
+ * A snapshot holds the tree without any pointer: nodes are numbered in
+ * breadth-first order from the root (node 0), so the children of a node are
+ * consecutive nodes, and the first bytes of the labels of all the nodes are
+ * in one array, in the same order. setOpen uses the mapped arrays directly,
+ * and the first insertion of a new key builds the nodes in memory from them.
+ */
+typedef struct FlatNode_t // mapped radix node
 {
-    EdgeList *edges;
-    char *key;
-};
+    uint32_t label;       // offset of the label in the labels section
+    uint32_t labelLength;
+    uint32_t firstChild;  // number of the first child
+    uint16_t nbChildren;
+    uint16_t terminal;
+} FlatNode;
 
 struct Set_t // radix set
 {
-    RNode *root;
+    RNode *root;          // NULL if the set is empty or mapped
     size_t size;
+    size_t maxKeyLength;
+    const FlatNode *flatNodes; // the tree if it is mapped, NULL otherwise
+    const unsigned char *flatFirstBytes;
+    const char *flatLabels;
+    size_t nbFlatNodes;
+    size_t labelsSize;
+    Snapshot *snapshot;   // the file holding them if they are mapped, NULL otherwise
 };
 
-/* STATIC FUNCTIONS */
-static char *duplicate_string(const char *str);
-static void terminate(char *m);
-static void concatenate_string(char **str1, const char *str2);
-static void copy_string(char **copy, const char *str);
-static int isPrefix(const char *word, const char *prefix);
-static char *getRest(const char *key, const char *pref);
-static char *getCommonPref(const char *str1, const char *str2);
-
-static EdgeList *edgeListNew(void);
-static bool edgesInsertLast(EdgeList *l, RNode *targetNode, const char *label);
-static bool addEdge(RNode *source, RNode *target, const char *label);
-static void setEdgeLabel(Edge *e, char *newLabel);
-
-static RNode *rnNew(const char *key);
-static bool isLeaf(RNode *node);
+/* SNAPSHOT LAYOUT */
 
-/**
- * @brief Duplicate a string
- *
- * @param str
- * @return char*
- */
-static char *duplicate_string(const char *str)
+#define SECTION_HEADER 1
+#define SECTION_NODES 2
+#define SECTION_FIRST_BYTES 3
+#define SECTION_LABELS 4
+
+typedef struct SnapshotHeader_t
 {
-    char *copy = malloc(strlen(str) + 1);
-    if (!copy)
-        return NULL;
-    memcpy(copy, str, strlen(str) + 1);
-    return copy;
-}
+    uint64_t size;
+    uint64_t maxKeyLength;
+    uint64_t nbNodes;
+    uint64_t labelsSize;
+} SnapshotHeader;
+
+/*
+ * Traversals never build the path string: they keep an offset into the
+ * searched key and compare each label with the characters found at that
+ * offset. Two children of a node never start with the same character and
+ * only the root has an empty label, so at most one child can be followed.
+ */
+
+/* STATIC FUNCTIONS */
+static unsigned char *firstBytes(const RNode *n);
+static int findChild(const unsigned char *bytes, int nbChildren, char c);
+static size_t matchLabel(const char *label, size_t labelLength, const char *str);
+static bool addChild(RNode *n, RNode *child);
+
+static RNode *rnNew(const char *label, size_t length, bool terminal);
+static void rnFree(RNode *n);
+static void freeRec(RNode *n);
+static bool isLeaf(const RNode *node);
+static bool addPrefixToList(const char *key, size_t length, void *list);
+static size_t memoryRec(const RNode *n);
+
+static const FlatNode *flatStep(const Set *radix, const FlatNode *node, const char *str);
+static void countRec(const RNode *n, size_t *nbNodes, size_t *labelsSize);
+static bool flatten(const Set *radix, FlatNode **nodes, unsigned char **bytes, char **labels, SnapshotHeader *header);
+static RNode *thawRec(const Set *radix, const FlatNode *node);
+static bool detach(Set *radix);
+static bool checkSnapshot(const SnapshotHeader *header, const FlatNode *nodes, const unsigned char *bytes, const char *labels);
+static bool flatVisitRec(const Set *radix, const FlatNode *node, char *path, size_t length, SetVisitor visit, void *context);
+static bool buildChildren(RNode *n, const char **keys, size_t nbKeys, size_t depth);
+static RNode *buildRec(const char **keys, size_t nbKeys, size_t depth);
+static bool visitRec(const RNode *n, char *path, size_t length, SetVisitor visit, void *context);
 
 /**
- * @brief Terminate the program and display a message
+ * @brief Returns the first bytes of the children labels of a node
+ *
+ * @param n a pointer to a RNode
  *
- * @param m
+ * @return unsigned char*, an array of n->nbChildren sorted bytes
  */
-static void terminate(char *m)
-{
-    fprintf(stderr, "%s\n", m);
-    exit(EXIT_FAILURE);
+static unsigned char *firstBytes(const RNode *n){
+    return (unsigned char *)(n->children + n->capacity);
 }
 
 /**
- * @brief Concatenates 2 strings 
- * 
- * @param str1 a pointer to a string (will contain result)
- * @param str2 a string
+ * @brief Finds the child of a node whose label starts with a character.
+ *        The first bytes are compared 16 at a time when SSE2 is available.
+ *
+ * @param bytes the sorted first bytes of the children labels of a node
+ * @param nbChildren the number of children of the node
+ * @param c a character (not \0)
+ *
+ * @return int, the index of the child
+ *         -1, if there is none
  */
-static void concatenate_string(char **str1, const char *str2){
-    size_t len1 = strlen(*str1);
-    size_t len2 = strlen(str2);
-    
-    *str1 = realloc(*str1, (len1 + len2 + 1) * sizeof(char));
-    if (!*str1){
-        terminate("Allocation Error : Failed to reallocate string\n");
+static int findChild(const unsigned char *bytes, int nbChildren, char c){
+    int i = 0;
+
+#ifdef __SSE2__
+    __m128i needle = _mm_set1_epi8(c);
+    for (; i + 16 <= nbChildren; i += 16){
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask != 0)
+            return i + __builtin_ctz((unsigned)mask);
     }
+#endif
 
-    strcat(*str1, str2);
+    for (; i < nbChildren; i++){
+        if (bytes[i] == (unsigned char)c)
+            return i;
+        if (bytes[i] > (unsigned char)c) // bytes are sorted
+            return -1;
+    }
+    return -1;
 }
 
 /**
- * @brief copies a string
- * 
- * @param copy a pointer to a string (will contain copy)
+ * @brief Counts the characters shared by the label of a node and the start of a string
+ *
+ * @param label the label of a node (not \0-terminated)
+ * @param labelLength the length of label
  * @param str a string
+ *
+ * @return size_t, the length of the longest common prefix of the label and str
  */
-static void copy_string(char **copy, const char *str){
-    size_t len1 = strlen(*copy);
-    size_t len2 = strlen(str);
-    
-    *copy = realloc(*copy, (len1 + len2 +1) * sizeof(char));
-    if (!*copy){
-        terminate("Allocation Error : Failed to reallocate string\n");
-    }
-
-    strcpy(*copy, str);
+static size_t matchLabel(const char *label, size_t labelLength, const char *str){
+    size_t i = 0;
+    while (i < labelLength && label[i] == str[i])
+        i++;
+    return i;
 }
 
 /**
- * @brief frees a radix tree recursively a starting node (root node to free whole set)
- * 
- * @param n a pointer to a RNode (radix node)
+ * @brief Adds a child to a node, keeping the first bytes sorted
+ *
+ * @param n a pointer to a RNode
+ * @param child a pointer to a RNode, whose label starts with a character
+ *              no other child of n starts with
+ *
+ * @return bool, true if the child has been added
+ *               false in case of allocation error
  */
-static void freeRec(RNode *n){
-    Edge *edge = NULL;
-    if (n->edges->head != NULL)
-        edge = n->edges->head;
-    Edge *prev = NULL;
-    while (edge != NULL){
-
-        freeRec(edge->targetNode);
-        prev = edge;
-        edge = edge->next;
-        
-        free(prev->label);
-        free(prev);
-    }
-    
-    free(n->key);
-    free (n->edges);
-    free(n);
+static bool addChild(RNode *n, RNode *child){
+    if (n->nbChildren == n->capacity){
+        uint16_t capacity = n->capacity ? 2 * n->capacity : 1;
+        if (capacity > 256)
+            capacity = 256;
+
+        RNode **children = realloc(n->children, capacity * (sizeof(RNode *) + 1));
+        if (!children){
+            printf("Allocation Error : Failed to add a child to a node\n");
+            return false;
+        }
+        // the first bytes follow the pointers: move them after the new ones
+        memmove(children + capacity, children + n->capacity, n->nbChildren);
+        n->children = children;
+        n->capacity = capacity;
+    }
+
+    unsigned char *bytes = firstBytes(n);
+    unsigned char c = (unsigned char)child->label[0];
+    int i = n->nbChildren;
+    while (i > 0 && bytes[i - 1] > c){
+        bytes[i] = bytes[i - 1];
+        n->children[i] = n->children[i - 1];
+        i--;
+    }
+    bytes[i] = c;
+    n->children[i] = child;
+    n->nbChildren++;
+    return true;
 }
 
 /**
- * @brief gets the remaining substring of a key (key - pref)
- * 
- * @param key a string
- * @param pref a string (normally a substring of key)
- * 
- * @return char* the remaining substring (key - pref)
- *         NULL if there is no substring remain
+ * @brief Creates a new RNode object (radix node) without children
+ *
+ * @param label the label of the edge leading to the node
+ * @param length the length of label
+ * @param terminal whether a key ends at the node
+ *
+ * @return RNode*, a pointer to a valid RNode object
+ *         NULL, in case of error
  */
-static char *getRest(const char *key, const char *pref){
-   
-    size_t keySize = strlen(key);
-    size_t prefSize = strlen(pref);
-
-    if (prefSize > keySize){ // cannot get a remaining substring
-        return NULL;
-    }
-
-    size_t restSize = keySize - prefSize;
-
-    char *rest = malloc(sizeof(char) * (restSize + 1));
-
-    if (!rest){
-        printf("Allocation Error : Failed to allocate rest\n");
+static RNode *rnNew(const char *label, size_t length, bool terminal){
+    RNode *n = malloc(sizeof(RNode) + length);
+    if (!n){
+        printf("Error : Failed to allocate a new node\n");
         return NULL;
     }
+    n->children = NULL;
+    n->nbChildren = 0;
+    n->capacity = 0;
+    n->terminal = terminal;
+    n->labelLength = length;
+    memcpy(n->label, label, length);
 
-    int j = prefSize;
-    for (size_t i = 0; i < restSize; i++){
-        rest[i] = key[j];
-        j++;
-    }
-
-    rest[restSize] = '\0';
-    return rest;
+    return n;
 }
 
 /**
- * @brief Gets the common prefix of 2 strings
+ * @brief frees a single radix node, but not its children
  *
- * @param str1 a string
- * @param str2 a string
- * 
- * @return char* the common prefix between str1 and str2               
+ * @param n a pointer to a RNode (radix node)
  */
-static char *getCommonPref(const char *str1, const char *str2){
-    size_t size1 = strlen(str1);
-    size_t size2 = strlen(str2);
-
-    char *commonPref = malloc(sizeof(char) * (size1 + 1));
-    if (!commonPref){
-        printf("Allocation Error : Failed to allocate commonPref\n");
-        return NULL;
-    }
+static void rnFree(RNode *n){
+    free(n->children);
+    free(n);
+}
 
-    bool match = true;
-    unsigned int j = 0;
-    size_t i = 0;
-    while (i < size1 && i < size2 && match){
-        if (str1[i] == str2[i]){
-            commonPref[j] = str1[i];
-            j++;
-        }
-        else 
-            match = false;
+/**
+ * @brief frees a radix tree recursively a starting node (root node to free whole set)
+ *
+ * @param n a pointer to a RNode (radix node)
+ */
+static void freeRec(RNode *n){
+    for (uint16_t i = 0; i < n->nbChildren; i++)
+        freeRec(n->children[i]);
 
-        i++;
-    }
-    commonPref[j] = '\0';
-    return commonPref;
+    rnFree(n);
 }
 
 /**
  * @brief Checks if a radix node is a leaf
- * 
+ *
  * @param node a pointer to RNode object
- * 
+ *
  * @return true if the node is a leaf
  *         false otherwise
  */
-static bool isLeaf(RNode *node){
-   return (node->edges->size == 0);
+static bool isLeaf(const RNode *node){
+   return (node->nbChildren == 0);
 }
 
+/* ----------------- RADIX MAPPED NODES --------------------- */
+
 /**
- * @brief Checks if a given word is a prefix of a string
+ * @brief Follows from a mapped node the child whose label starts a string
  *
- * @param str a string
- * @param word a string (word to be checked)
- * 
- * @return bool : true if word is a prefix of str
- *                false otherwise
+ * @param radix a pointer to a mapped radix set
+ * @param node a pointer to a FlatNode of radix
+ * @param str a string (not empty)
+ *
+ * @return const FlatNode*, the child, whose whole label is a prefix of str
+ *         NULL, if there is none
  */
-static int isPrefix(const char *word, const char *prefix) {
+static const FlatNode *flatStep(const Set *radix, const FlatNode *node, const char *str){
+    int i = findChild(radix->flatFirstBytes + node->firstChild, node->nbChildren, str[0]);
+    if (i < 0)
+        return NULL;
 
-    // Use strncmp to compare the first strlen(prefix) characters of word with prefix
-    return strncmp(word, prefix, strlen(prefix)) == 0;
+    const FlatNode *child = radix->flatNodes + node->firstChild + i;
+    if (matchLabel(radix->flatLabels + child->label, child->labelLength, str) != child->labelLength)
+        return NULL;
+    return child;
 }
 
 /**
- * @brief Creates an empty edge list
- * 
- * @return EdgeList*, a pointer to a a valid EdgeList
- *         NULL, in error case
+ * @brief Counts the nodes of a radix tree and the characters of their labels
+ *
+ * @param n a pointer to a RNode (radix node)
+ * @param nbNodes incremented by the number of nodes of the tree
+ * @param labelsSize incremented by the total length of their labels
  */
-static EdgeList *edgeListNew(void){
-    EdgeList *edgeList = malloc(sizeof(EdgeList));
-    if (!edgeList){
-        return NULL;
-    }
-    edgeList->head = NULL;
-    edgeList->last = NULL;
-    edgeList->size = 0;
-    return edgeList;
+static void countRec(const RNode *n, size_t *nbNodes, size_t *labelsSize){
+    (*nbNodes)++;
+    *labelsSize += n->labelLength;
+    for (uint16_t i = 0; i < n->nbChildren; i++)
+        countRec(n->children[i], nbNodes, labelsSize);
 }
 
 /**
- * @brief Inserts a new element (Edge) at the end of an Edgelist.
- * 
- * @param l A valid pointer to a  EdgeList object
- * @param targetNode A pointer to RNode object (target node of the inserted edge)
- * @param label a string, the label of the inserted edge
- * 
- * @return bool, true if the edge was successfully inserted
- *               false other wise
+ * @brief Numbers the nodes of a radix tree in memory in breadth-first order,
+ *        and writes them, their first bytes and their labels in three arrays,
+ *        which need to be freed by the user. An empty set is written as a
+ *        root without children.
+ *
+ * @param radix a pointer to a radix set that is not mapped
+ * @param nodes set to the array of nodes
+ * @param bytes set to the array of first bytes
+ * @param labels set to the labels
+ * @param header its nbNodes and labelsSize are set
+ *
+ * @return bool, false in case of allocation error, or if the tree is too big
+ *               to be numbered
  */
-static bool edgesInsertLast(EdgeList *l, RNode *targetNode, const char *label)
-{
-    Edge *edge = malloc(sizeof(Edge));
-    if (!edge){
-        printf("Allocation Error :Failed to insert a new edge to edges list \n");
+static bool flatten(const Set *radix, FlatNode **nodes, unsigned char **bytes, char **labels, SnapshotHeader *header){
+    size_t nbNodes = 0, labelsSize = 0;
+    if (radix->root)
+        countRec(radix->root, &nbNodes, &labelsSize);
+    if (nbNodes >= UINT32_MAX || labelsSize >= UINT32_MAX)
+        return false;
+
+    const RNode **order = malloc((nbNodes + 1) * sizeof(RNode *)); // the nodes by number
+    *nodes = calloc(nbNodes + 1, sizeof(FlatNode));
+    *bytes = calloc(nbNodes + 1, 1);
+    *labels = malloc(labelsSize + 1);
+    if (!order || !*nodes || !*bytes || !*labels){
+        printf("Allocation Error : Failed to flatten a radix tree\n");
+        free(order);
+        free(*nodes);
+        free(*bytes);
+        free(*labels);
         return false;
     }
-    // Initialisation
-    edge->next = NULL;
-    edge->targetNode = targetNode;
-    edge->label = duplicate_string(label);
-    if (!edge->label){
-        free(edge);
-        return NULL;
+
+    size_t nbNumbered = 0, labelsEnd = 0;
+    if (radix->root)
+        order[nbNumbered++] = radix->root;
+    for (size_t i = 0; i < nbNumbered; i++){
+        const RNode *n = order[i];
+        (*nodes)[i] = (FlatNode){(uint32_t)labelsEnd, (uint32_t)n->labelLength, (uint32_t)nbNumbered, n->nbChildren, n->terminal};
+        memcpy(*labels + labelsEnd, n->label, n->labelLength);
+        labelsEnd += n->labelLength;
+
+        // the children of n are numbered in a row
+        for (uint16_t j = 0; j < n->nbChildren; j++){
+            (*bytes)[nbNumbered] = firstBytes(n)[j];
+            order[nbNumbered++] = n->children[j];
+        }
     }
-    // Adding the node to the list
-    if (!l->last)
-    {
-        // First element in the list
-        l->last = edge;
-        l->head = edge;
-    }
-    else
-    {
-        // At least one element in the list
-        l->last->next = edge;
-        l->last = edge;
-    }
-    // In both cases, increment size
-    l->size++;
+
+    header->nbNodes = nbNodes > 0 ? nbNodes : 1;
+    header->labelsSize = labelsSize;
+    free(order);
     return true;
 }
 
 /**
- * @brief Adds an edge from a source node 
- * 
- * @param source a pointer to RNode, the source node
- * @param target a pointer to RNode, the target node
- * @param label  a string, the label of the new edge between both nodes
- * 
- * @return bool, true if the edge has been successfully inserted
- *               false otherwise
+ * @brief Builds in memory the subtree of a mapped node
+ *
+ * @param radix a pointer to a mapped radix set
+ * @param node a pointer to a FlatNode of radix
+ *
+ * @return RNode*, the root of the subtree
+ *         NULL, in case of allocation error
  */
-static bool addEdge(RNode *source, RNode *target, const char *label){
-    return edgesInsertLast(source->edges, target, label);
+static RNode *thawRec(const Set *radix, const FlatNode *node){
+    RNode *n = rnNew(radix->flatLabels + node->label, node->labelLength, node->terminal);
+    if (!n)
+        return NULL;
+
+    if (node->nbChildren > 0){
+        n->children = malloc(node->nbChildren * (sizeof(RNode *) + 1));
+        if (!n->children){
+            printf("Allocation Error : Failed to add a child to a node\n");
+            rnFree(n);
+            return NULL;
+        }
+        n->capacity = node->nbChildren;
+        memcpy(firstBytes(n), radix->flatFirstBytes + node->firstChild, node->nbChildren);
+    }
+
+    for (uint16_t i = 0; i < node->nbChildren; i++){
+        RNode *child = thawRec(radix, radix->flatNodes + node->firstChild + i);
+        if (!child){
+            freeRec(n);
+            return NULL;
+        }
+        n->children[n->nbChildren++] = child;
+    }
+    return n;
 }
 
 /**
- * @brief updates the label of an edge
- * 
- * @param e a pointer to Edge
- * @param newLabel a string, the new label 
+ * @brief Builds in memory the tree of a radix set opened from a snapshot, so
+ *        that it can be modified
+ *
+ * @param radix a pointer to a radix set
+ *
+ * @return bool, false in case of allocation error
  */
-static void setEdgeLabel(Edge *e, char *newLabel){
-    if (e->label){
-        free(e->label);
-    }
-    e->label = duplicate_string(newLabel);
-    if (!e->label){
-        free(e);
-        terminate("Error : Failed to duplicate string");
-    }
+static bool detach(Set *radix){
+    if (!radix->snapshot)
+        return true;
+
+    radix->root = thawRec(radix, radix->flatNodes);
+    if (!radix->root)
+        return false;
+
+    snapshotClose(radix->snapshot);
+    radix->snapshot = NULL;
+    radix->flatNodes = NULL;
+    radix->flatFirstBytes = NULL;
+    radix->flatLabels = NULL;
+    return true;
 }
 
 /**
- * @brief Creates a new RNode object (radix node)
- * 
- * @param key a string, the key of the new node
- * 
- * @return RNode*, a pointer to a valid RNode object 
- *         NULL, in case of error
+ * @brief Checks that the mapped arrays of a snapshot describe a radix tree
+ *        that the traversals can follow without leaving them: nodes are
+ *        numbered in breadth-first order, so each node is the child of a
+ *        single node numbered before it; labels lie in the labels section
+ *        and start with the first byte recorded for them; the first bytes of
+ *        the children of a node are sorted; the longest path is maxKeyLength
+ *        long, and the terminal nodes are as many as the keys.
+ *
+ * @param header the header of the snapshot, whose sizes match the sections
+ * @param nodes the mapped nodes
+ * @param bytes the mapped first bytes
+ * @param labels the mapped labels
+ *
+ * @return bool, true if the arrays can be used as they are
  */
-static RNode *rnNew(const char *key){
-    RNode *n = malloc(sizeof(RNode));
-    if (!n){
-        printf("Error : Failed to allocate a new node\n");
-        return NULL;
-    }
-    n->edges = edgeListNew();
-    if (!n->edges){
-        free(n);
-        return NULL;
+static bool checkSnapshot(const SnapshotHeader *header, const FlatNode *nodes, const unsigned char *bytes, const char *labels){
+    size_t nbNodes = header->nbNodes;
+    if (nodes[0].labelLength != 0)
+        return false;
+
+    // depths[i] is the length of the path from the root to node i
+    size_t *depths = malloc(nbNodes * sizeof(size_t));
+    if (!depths){
+        printf("Allocation Error : Failed to check a radix snapshot\n");
+        return false;
     }
-    n->key = duplicate_string(key);
-    if (!n->key){
-        free(n);
-        free(n->edges);
-        return NULL;
+    depths[0] = 0;
+
+    size_t nbReached = 1; // nodes already given a parent, the root included
+    size_t maxDepth = 0;
+    uint64_t nbTerminals = 0;
+    bool ok = true;
+    for (size_t i = 0; ok && i < nbNodes; i++){
+        const FlatNode *node = &nodes[i];
+        ok = i < nbReached && node->terminal <= 1 &&
+             (uint64_t)node->label + node->labelLength <= header->labelsSize &&
+             (node->nbChildren == 0 ? node->firstChild <= nbNodes
+                                    : node->firstChild == nbReached && nbReached + node->nbChildren <= nbNodes);
+        nbTerminals += node->terminal;
+        if (!ok || node->nbChildren == 0)
+            continue;
+
+        // the children of node are the next nodes still without a parent
+        nbReached += node->nbChildren;
+        for (uint16_t j = 0; ok && j < node->nbChildren; j++){
+            size_t child = node->firstChild + j;
+            size_t labelLength = nodes[child].labelLength;
+            ok = labelLength > 0 && labelLength <= header->maxKeyLength - depths[i] &&
+                 (uint64_t)nodes[child].label + labelLength <= header->labelsSize &&
+                 (unsigned char)labels[nodes[child].label] == bytes[child] &&
+                 (j == 0 || bytes[child - 1] < bytes[child]);
+            if (ok)
+                depths[child] = depths[i] + labelLength;
+            if (ok && depths[child] > maxDepth)
+                maxDepth = depths[child];
+        }
     }
 
-    return n;
+    free(depths);
+    return ok && nbReached == nbNodes && maxDepth == header->maxKeyLength && nbTerminals == header->size;
 }
 
 /* ----------------- RADIX SET OPERATIONS --------------------- */
@@ -370,339 +496,141 @@ Set *setCreateEmpty(void){
 
     radix->root = NULL;
     radix->size = 0;
- 
+    radix->maxKeyLength = 0;
+    radix->flatNodes = NULL;
+    radix->flatFirstBytes = NULL;
+    radix->flatLabels = NULL;
+    radix->nbFlatNodes = 0;
+    radix->labelsSize = 0;
+    radix->snapshot = NULL;
+
     return radix;
 }//end setCreateEmpty
 
 
 bool setContains(const Set *radix, const char *key){
+    if (radix->snapshot){
+        const FlatNode *node = radix->flatNodes;
+        size_t offset = 0;
+        while (node && key[offset] != '\0'){
+            node = flatStep(radix, node, key + offset);
+            if (node)
+                offset += node->labelLength;
+        }
+        return node && node->terminal;
+    }
+
     if (radix->root == NULL) // set is empty
         return false;
-    
-    RNode *n = radix->root;
-    Edge *e = NULL;
 
-    char *pref = duplicate_string(n->key); //initializing an empty pref
-    if (!pref){
-        terminate("Error : Failed to duplicate pref in setContains");
-    }
+    const RNode *n = radix->root;
+    size_t offset = 0; // number of characters of key matched so far
 
-    char *tmp = duplicate_string(n->key); //initializing an empty string
-    if (!tmp){
-        free(pref);
-        terminate("Error : Failed to duplicate tmp in setContains");
-    }
- 
-    while (n != NULL){
-         
-        int cmp = strcmp(key, n->key);
-        if (cmp == 0){
-            free(tmp);
-            free(pref);
-            return true;
-        }
-        
-        if (isLeaf(n)){ 
-            // node is a leaf, there's no further moves
-            free(pref);
-            free(tmp);
+    while (key[offset] != '\0'){
+        int i = findChild(firstBytes(n), n->nbChildren, key[offset]);
+        if (i < 0)
             return false;
-        }
-        
-        e = n->edges->head;
-        bool isPref = false;
-        while (e != NULL && !isPref){
-
-            // concatenate the current prefix with the current edge label
-            concatenate_string(&pref, e->label); 
-            
-            if (isPrefix(key, pref)){
-                
-                copy_string(&tmp, pref); // update tmp to the current prefix
-                n = e->targetNode;
-                isPref = true;
-            }
 
-            else {
-                copy_string(&pref, tmp); // back the the latest prefix
-                e = e->next;
-            }     
-        }
-        if (e == NULL){ 
-            // all edges of the current node have been visited and key was not found
-            free(tmp);
-            free(pref);  
+        n = n->children[i];
+        size_t matched = matchLabel(n->label, n->labelLength, key + offset);
+        if (matched != n->labelLength) // key diverges from the label, or ends inside it
             return false;
-        }
+
+        offset += matched;
     }
-   
-    free(tmp);
-    free(pref);
-    return false;
+
+    return n->terminal;
 }//end setContains
 
 
 int setInsert(Set *radix, const char *key){
-    
+
     if (!radix)
         return -1;
 
+    // a mapped set is only built in memory for a new key
+    if (radix->snapshot && setContains(radix, key))
+        return 0;
+    if (!detach(radix))
+        return -1;
+
+    // an upper bound: a key already there is not longer than the longest one
+    size_t length = strlen(key);
+    if (length > radix->maxKeyLength)
+        radix->maxKeyLength = length;
+
     // SET IS EMPTY
     if (radix->root == NULL){
-        radix->root = rnNew("");
+        radix->root = rnNew("", 0, false);
         if (!radix->root){
             return -1;
         }
-        RNode *newNode = rnNew(key);
-        if (!newNode){
-            printf("Allocation Error : Failed to create a new Node\n");
-            return -1;
-        }
-
-        if (!addEdge(radix->root, newNode, key)){ // add an edge from root
-            free(newNode);
-            return -1;
-        }
-        radix->size++;
-      
-        return 1;
     }
 
     // Start at the root
     RNode *n = radix->root;
-    Edge *e = NULL;
+    size_t offset = 0; // number of characters of key matched so far
 
-    char *pref = duplicate_string(n->key); //initializing an empty string
-    if (!pref){
-        return -1;
-    }
+    while (key[offset] != '\0'){
+        int i = findChild(firstBytes(n), n->nbChildren, key[offset]);
 
-    char *tmp = duplicate_string(n->key); //initializing an empty string
-    if (!tmp){
-        free(pref);
-        return -1;
-    }
-
-    int cmp = 0;
-    while (n != NULL){
-        
-        cmp = strcmp(key, n->key);
-
-        if (cmp == 0){
-            free(tmp);
-            free(pref);
-            return 0;
-        }
-        
-        e = n->edges->head;
-        bool prefix = false;
-        while (e != NULL && !prefix){
-            
-            concatenate_string(&pref, e->label); // concatenate the current label with current prefix
-
-            if (isPrefix(key, pref)){
-               
-                copy_string(&tmp, pref); // update tmp to the current prefix
-                n = e->targetNode;
-                 
-                prefix = true;   
-            }
-
-            else {
-                
-                copy_string(&pref, tmp); // back to the latest state (latest prefix)
-                     
-                char *rest = getRest(key, pref); // rest of the current prefix   
-                if (!rest){
-                    printf("Error : Failed to get rest in setInsert\n");
-                    free(tmp);
-                    free(pref);
-                    return -1;
-                }      
-                
-                char *commonPref = getCommonPref(e->label, rest); // common prefix of the edge label and the rest of current prefix
-                free(rest);
-                
-                if (!commonPref){
-                    printf("Error : Failed to get common prefix in setInsert\n");
-                    free(tmp);
-                    free(pref);
-                    return -1;
-                }
-                 
-                if (strlen(commonPref) > 0){
-                    
-                    concatenate_string(&pref, commonPref); // concatenate the common prefix with the current prefix 
-                
-                    RNode *newNode = rnNew(key); // create the new node
-                        if (!newNode){
-                            free(tmp);
-                            free(pref);
-                            free(commonPref);
-                            return -1;
-                        }
-
-                    RNode *oldNode = e->targetNode;        
-                        
-                    if (isPrefix(oldNode->key, key)){ // if the key-to-insert is a prefix of the node's key
-                        e->targetNode = newNode;
-                            
-                        char *newRest = getRest(newNode->key, tmp); // the remaining substring of new node
-                        setEdgeLabel(e, newRest); // update the new node's label
-
-                        char *oldRest = getRest(oldNode->key, pref); // the remaining substring of old node
-                        if (!addEdge(newNode, oldNode, oldRest)){
-                            free(tmp);
-                            free(pref);
-                            free(oldRest);
-                            free(commonPref);
-                            free(newRest);
-                            return -1;
-                        }
-
-                        radix->size++;
-
-                        free(tmp);
-                        free(pref);
-                        free(oldRest);
-                        free(commonPref);
-                        free(newRest);
-                        return 1;
-                    }
-
-                    else { // if the key-to-insert is not a prefix of the node's key
-                        
-                        RNode *emptyNode = rnNew("");
-                        if (!emptyNode){
-                            free(tmp);
-                            free(pref);
-                            free(commonPref);
-                            return -1;
-                        }
-                        
-                        e->targetNode = emptyNode;
-                    
-                        char *oldRest;
-                        if (strlen(oldNode->key) == 0) // node is empty{}
-                            oldRest = getRest(e->label, commonPref);                                
-
-                        else 
-                            oldRest = getRest(oldNode->key, pref);  
-
-                        setEdgeLabel(e, commonPref);
-
-                        // add an edge to the old node with a new edge label
-                        if (!addEdge(emptyNode, oldNode, oldRest)){
-                            free(commonPref);
-                            free(tmp);
-                            free(pref);
-                            free(oldRest);
-                            return -1;
-
-                        }
-                            
-                        // add an edge to the new node with a new edge label
-                        char *newRest = getRest(newNode->key, pref);  
-                        
-                        if (!addEdge(emptyNode, newNode, newRest)){
-                            free(commonPref);
-                            free(tmp);
-                            free(pref);
-                            free(oldRest);
-                            free(newRest);
-                            return -1;
-                        }
-
-                        radix->size++;
-
-                        free(commonPref);
-                        free(tmp);
-                        free(pref);
-                        free(oldRest);
-                        free(newRest);
-                        return 1;
-                    }                       
-                }
-                else { // there is no common prefix between edge label and key
-                    free(commonPref);
-                    e = e->next;
-                }
-            }
-
-        }//end while 2
-
-        if (isLeaf(n) && strcmp(n->key, key) != 0){ // node is a leaf and we cannot make any progress
-            RNode *newNode = rnNew(key);
-            if (!newNode){
-                free(tmp);
-                free(pref);
+        if (i < 0){ // no child shares a prefix with the rest of the key: add a leaf
+            RNode *leaf = rnNew(key + offset, strlen(key + offset), true);
+            if (!leaf)
                 return -1;
-            }
 
-            char *newRest = getRest(newNode->key, pref);
-            if (!addEdge(n, newNode, newRest)){
-                free(pref);
-                free(tmp);
-                free(newRest);
+            if (!addChild(n, leaf)){
+                rnFree(leaf);
                 return -1;
             }
 
             radix->size++;
-            
-            free(pref);
-            free(tmp);
-            free(newRest);
             return 1;
         }
 
-        // There is no edge containing any common prefix with key
-        if (e == NULL){
-            
-            RNode *newNode = rnNew(key);
-            if (!newNode){
-                free(tmp);
-                free(pref);
-                return -1;
-            }
-
-            char *newRest = getRest(key, pref);
-        
-            if (!addEdge(n, newNode, newRest)){
-                free(newRest);
-                free(tmp);
-                free(pref);
-            }
-
-            radix->size++;
-
-            free(newRest);
-            free(tmp);       
-            free(pref);    
-            return 1;
+        RNode *child = n->children[i];
+        size_t matched = matchLabel(child->label, child->labelLength, key + offset);
+        if (matched == child->labelLength){ // the whole label matches, go down
+            n = child;
+            offset += matched;
+            continue;
         }
 
-        else {            
-            cmp = strcmp(pref, key);
-            if (cmp == 0 && strlen(e->targetNode->key) == 0){
-                free(e->targetNode->key); // empty the old node key
-
-                e->targetNode->key = duplicate_string(key);
-                if (!e->targetNode->key){
-                    free(tmp);
-                    free(pref);
-                    return -1;
-                }
-
-                radix->size++;
-                free(tmp);
-                free(pref);
-                return 1;
-            }       
+        // the key leaves (or ends inside) the label: split it after the common prefix
+        bool endsHere = (key[offset + matched] == '\0');
+
+        RNode *middle = rnNew(child->label, matched, endsHere);
+        RNode *rest = rnNew(child->label + matched, child->labelLength - matched, child->terminal);
+        RNode *leaf = endsHere ? NULL : rnNew(key + offset + matched, strlen(key + offset + matched), true);
+        if (!middle || !rest || (!endsHere && !leaf) ||
+            !addChild(middle, rest) || (!endsHere && !addChild(middle, leaf))){
+            if (middle)
+                rnFree(middle);
+            if (rest)
+                rnFree(rest);
+            if (leaf)
+                rnFree(leaf);
+            return -1;
         }
+
+        // rest takes over the children of the split node
+        rest->children = child->children;
+        rest->nbChildren = child->nbChildren;
+        rest->capacity = child->capacity;
+        free(child);
+        n->children[i] = middle;
+
+        radix->size++;
+        return 1;
     }
-    free(tmp);
-    free(pref);
-    return -1;   
+
+    // the whole key is a path of the tree, ending at n
+    if (n->terminal)
+        return 0;
+
+    n->terminal = true;
+    radix->size++;
+    return 1;
 }// end setInsert
 
 size_t setNbKeys(const Set *radix){
@@ -713,117 +641,450 @@ size_t setNbKeys(const Set *radix){
     return radix->size;
 }//end setNbKeys
 
+/**
+ * @brief computes recursively the memory used by a radix tree from a starting node
+ *
+ * @param n a pointer to a RNode (radix node)
+ *
+ * @return size_t the number of bytes used by n and its descendants
+ */
+static size_t memoryRec(const RNode *n){
+    size_t bytes = sizeof(RNode) + n->labelLength + n->capacity * (sizeof(RNode *) + 1);
+    for (uint16_t i = 0; i < n->nbChildren; i++)
+        bytes += memoryRec(n->children[i]);
+    return bytes;
+}
+
+size_t setMemoryUsage(const Set *set){
+    if (!set)
+        return 0;
+
+    if (set->snapshot)
+        return sizeof(Set) + set->nbFlatNodes * (sizeof(FlatNode) + 1) + set->labelsSize;
+    return sizeof(Set) + (set->root ? memoryRec(set->root) : 0);
+}//end setMemoryUsage
+
 void setFree(Set *set){
     if (!set)
         return;
-        
-    if (set->root){
+
+    if (set->snapshot){
+        snapshotClose(set->snapshot);
+    }
+    else if (set->root){
         freeRec(set->root);
     }
 
     free(set);
 }// end setFree
 
-List *setGetAllStringPrefixes(const Set *set, const char *str) 
+/**
+ * @brief SetVisitor appending a copy of each key to a list
+ *
+ * @param key the key found
+ * @param length the length of key
+ * @param list a pointer to a List
+ *
+ * @return bool, true if the key was added
+ *               false in case of allocation error
+ */
+static bool addPrefixToList(const char *key, size_t length, void *list){
+    char *copy = malloc(length + 1);
+    if (!copy)
+        return false;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+
+    if (!listInsertLast(list, copy)){
+        free(copy);
+        return false;
+    }
+    return true;
+}
+
+List *setGetAllStringPrefixes(const Set *set, const char *str)
 {
-   // we proceed as in search
    List *prefixList = listNew();
    if (!prefixList){
     printf("Failed to get all prefixes\n");
     return NULL;
    }
 
-   if (set->root == NULL){
-    return prefixList;
+   if (!setVisitAllStringPrefixes(set, str, addPrefixToList, prefixList)){
+    listFree(prefixList, true);
+    return NULL;
    }
-   
-    RNode *n = set->root;
-    Edge *e = NULL;
-    char *pref = duplicate_string(n->key); //initializing an empty pref
-    if (!pref){
-        return NULL;
+   return prefixList;
+}//end setGetAllStringPrefixes
+
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context){
+    if (set->snapshot){
+        const FlatNode *node = set->flatNodes;
+        size_t offset = 0;
+        while (str[offset] != '\0'){
+            node = flatStep(set, node, str + offset);
+            if (!node)
+                return true;
+
+            offset += node->labelLength;
+            if (node->terminal && !visit(str, offset, context))
+                return false;
+        }
+        return true;
     }
 
-    char *tmp = duplicate_string(n->key); //initializing an empty string
-    if (!tmp){
-        free(pref);
-        return NULL;
+    if (set->root == NULL)
+        return true;
+
+    // we proceed as in search, reporting every terminal node met on the way.
+    // Keys are not stored: the key found is the start of str itself.
+    const RNode *n = set->root;
+    size_t offset = 0; // number of characters of str matched so far
+    while (str[offset] != '\0'){
+        int i = findChild(firstBytes(n), n->nbChildren, str[offset]);
+        if (i < 0)
+            return true;
+
+        n = n->children[i];
+        size_t matched = matchLabel(n->label, n->labelLength, str + offset);
+        if (matched != n->labelLength)
+            return true;
+
+        offset += matched;
+        if (n->terminal && !visit(str, offset, context))
+            return false;
     }
+    return true;
+}//end setVisitAllStringPrefixes
 
-    size_t pCount = 0; // prefixes count
-    size_t strSize = strlen(str); // maximum prefixes count
-    while (n != NULL && pCount < strSize){
-        if (strcmp(str, n->key) == 0){ // no need to go further
 
-            char *copy = duplicate_string(n->key);
-            if (!copy){
-                free(tmp);
-                free(pref);
-                return NULL;
-            }
+/* ----------------- RADIX BULK CONSTRUCTION --------------------- */
 
-            if (!listInsertLast(prefixList, copy)){
-                free(copy);
-                free(tmp);
-                free(pref);
-                return NULL;
-            }
+/*
+ * Sorted keys sharing a prefix are contiguous, and the longest prefix shared
+ * by a range of sorted keys is the one shared by its first and last keys. The
+ * tree is thus built top-down in one pass over the keys: each node gets its
+ * whole label and its exact number of children at once, and nothing is ever
+ * split or moved.
+ */
 
-            pCount++;
-            free(pref);
-            free(tmp);
-            return prefixList;
-        }
-       
-        if (strlen(n->key) > 0 && isPrefix(str, n->key)){ // node is not empty and its key is a  prefix
-              
-            char *copy = duplicate_string(n->key);
-            if (!copy){
-                free(tmp);
-                free(pref);
-                return NULL;
-            }
+/**
+ * @brief Builds the children of a node from the keys that go through it
+ *
+ * @param n a pointer to a RNode without children
+ * @param keys distinct sorted keys starting with the path to n, except the
+ *             one ending at n
+ * @param nbKeys the number of keys
+ * @param depth the length of the path from the root to n
+ *
+ * @return bool, false in case of allocation error
+ */
+static bool buildChildren(RNode *n, const char **keys, size_t nbKeys, size_t depth){
+    // one child per distinct character following the path
+    size_t nbGroups = 0;
+    for (size_t i = 0; i < nbKeys; i++){
+        if (i == 0 || keys[i][depth] != keys[i - 1][depth])
+            nbGroups++;
+    }
+    if (nbGroups == 0)
+        return true;
 
-            if (!listInsertLast(prefixList, copy)){
-                free(copy);
-                free(tmp);
-                free(pref);
-                return NULL;
-            }
+    n->children = malloc(nbGroups * (sizeof(RNode *) + 1));
+    if (!n->children){
+        printf("Allocation Error : Failed to add a child to a node\n");
+        return false;
+    }
+    n->capacity = (uint16_t)nbGroups;
 
-            pCount++;
-        }
-        if (isLeaf(n)){
-            free(pref);
-            free(tmp);
-            return prefixList;
+    size_t start = 0;
+    while (start < nbKeys){
+        size_t end = start + 1;
+        while (end < nbKeys && keys[end][depth] == keys[start][depth])
+            end++;
+
+        RNode *child = buildRec(keys + start, end - start, depth);
+        if (!child)
+            return false;
+        // groups come in increasing order: the first bytes stay sorted
+        firstBytes(n)[n->nbChildren] = (unsigned char)child->label[0];
+        n->children[n->nbChildren++] = child;
+        start = end;
+    }
+    return true;
+}
+
+/**
+ * @brief Builds the subtree of the keys sharing a prefix followed by a same
+ *        character
+ *
+ * @param keys distinct sorted keys, sharing their first depth + 1 characters
+ * @param nbKeys the number of keys, at least 1
+ * @param depth the length of the path from the root to the parent of the subtree
+ *
+ * @return RNode*, the root of the subtree
+ *         NULL, in case of allocation error
+ */
+static RNode *buildRec(const char **keys, size_t nbKeys, size_t depth){
+    size_t end = sortedKeysCommonPrefix(keys[0], keys[nbKeys - 1]);
+    bool terminal = (keys[0][end] == '\0'); // only the first key can end here
+
+    RNode *n = rnNew(keys[0] + depth, end - depth, terminal);
+    if (!n)
+        return NULL;
+
+    if (!buildChildren(n, keys + terminal, nbKeys - terminal, end)){
+        freeRec(n);
+        return NULL;
+    }
+    return n;
+}
+
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys){
+    size_t nbSorted;
+    const char **sorted = sortedKeys(keys, nbKeys, &nbSorted);
+    if (!sorted)
+        return NULL;
+
+    Set *radix = setCreateEmpty();
+    if (radix && nbSorted > 0){
+        bool terminal = (sorted[0][0] == '\0');
+        radix->root = rnNew("", 0, terminal);
+        if (!radix->root || !buildChildren(radix->root, sorted + terminal, nbSorted - terminal, 0)){
+            setFree(radix);
+            radix = NULL;
         }
-        
-        e = n->edges->head;
-        bool isPref = false;
-        while (e != NULL && !isPref){
-            
-            concatenate_string(&pref, e->label);
-
-            if (isPrefix(str, pref)){
-                copy_string(&tmp, pref);
-                n = e->targetNode;
-                isPref = true;
+        else{
+            radix->size = nbSorted;
+            for (size_t i = 0; i < nbSorted; i++){
+                size_t length = strlen(sorted[i]);
+                if (length > radix->maxKeyLength)
+                    radix->maxKeyLength = length;
             }
+        }
+    }
 
-            else {
-                copy_string(&pref, tmp);
-                e = e->next;
-            }
+    free(sorted);
+    return radix;
+}//end setBuildFromSorted
+
+
+/* ----------------- RADIX KEYS --------------------- */
+
+/**
+ * @brief Calls visit on the keys of a subtree, in order
+ *
+ * @param n a pointer to a RNode
+ * @param path a buffer of maxKeyLength characters, starting with the string
+ *             read from the root to the parent of n
+ * @param length the length of that string
+ * @param visit the function called for each key
+ * @param context passed as is to visit
+ *
+ * @return bool, false if the visit was stopped
+ */
+static bool visitRec(const RNode *n, char *path, size_t length, SetVisitor visit, void *context){
+    memcpy(path + length, n->label, n->labelLength);
+    length += n->labelLength;
+
+    if (n->terminal && !visit(path, length, context))
+        return false;
+
+    for (uint16_t i = 0; i < n->nbChildren; i++){
+        if (!visitRec(n->children[i], path, length, visit, context))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Same as visitRec, for a mapped node
+ *
+ * @param radix a pointer to a mapped radix set
+ * @param node a pointer to a FlatNode of radix
+ * @param path a buffer of maxKeyLength characters, starting with the string
+ *             read from the root to the parent of node
+ * @param length the length of that string
+ * @param visit the function called for each key
+ * @param context passed as is to visit
+ *
+ * @return bool, false if the visit was stopped
+ */
+static bool flatVisitRec(const Set *radix, const FlatNode *node, char *path, size_t length, SetVisitor visit, void *context){
+    memcpy(path + length, radix->flatLabels + node->label, node->labelLength);
+    length += node->labelLength;
+
+    if (node->terminal && !visit(path, length, context))
+        return false;
+
+    for (uint16_t i = 0; i < node->nbChildren; i++){
+        if (!flatVisitRec(radix, radix->flatNodes + node->firstChild + i, path, length, visit, context))
+            return false;
+    }
+    return true;
+}
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context){
+    if (!set->root && !set->snapshot)
+        return true;
+
+    // no key is longer than the longest one inserted
+    char *path = malloc(set->maxKeyLength + 1);
+    if (!path)
+        return false;
+
+    bool ok = set->snapshot ? flatVisitRec(set, set->flatNodes, path, 0, visit, context)
+                            : visitRec(set->root, path, 0, visit, context);
+    free(path);
+    return ok;
+}//end setVisitAllKeys
+
+
+/* ----------------- RADIX SNAPSHOT --------------------- */
+
+bool setSave(const Set *set, const char *filename){
+    SnapshotKeys keys = {NULL, 0, 0};
+    bool ok = setVisitAllKeys(set, snapshotKeysAdd, &keys);
+
+    // a mapped set is written as it is
+    SnapshotHeader header = {set->size, set->maxKeyLength, set->nbFlatNodes, set->labelsSize};
+    FlatNode *nodes = NULL;
+    unsigned char *bytes = NULL;
+    char *labels = NULL;
+    ok = ok && (set->snapshot || flatten(set, &nodes, &bytes, &labels, &header));
+
+    SnapshotSection sections[] = {
+        {keys.data, keys.size},
+        {&header, sizeof(SnapshotHeader)},
+        {set->snapshot ? set->flatNodes : nodes, header.nbNodes * sizeof(FlatNode)},
+        {set->snapshot ? set->flatFirstBytes : bytes, header.nbNodes},
+        {set->snapshot ? set->flatLabels : labels, header.labelsSize},
+    };
+    ok = ok && snapshotWrite(filename, "RadixTrie", sections, 5);
+    free(keys.data);
+    free(nodes);
+    free(bytes);
+    free(labels);
+    return ok;
+}//end setSave
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "RadixTrie");
+    if (!snapshot)
+        return NULL;
+
+    size_t headerSize, nodesSize, bytesSize, labelsSize;
+    const SnapshotHeader *header = snapshotSection(snapshot, SECTION_HEADER, &headerSize);
+    const FlatNode *nodes = snapshotSection(snapshot, SECTION_NODES, &nodesSize);
+    const unsigned char *bytes = snapshotSection(snapshot, SECTION_FIRST_BYTES, &bytesSize);
+    const char *labels = snapshotSection(snapshot, SECTION_LABELS, &labelsSize);
+
+    Set *radix = malloc(sizeof(Set));
+    if (!radix || !header || !nodes || !bytes || !labels || headerSize != sizeof(SnapshotHeader) ||
+        header->nbNodes == 0 || header->nbNodes >= UINT32_MAX || header->labelsSize >= UINT32_MAX ||
+        nodesSize != header->nbNodes * sizeof(FlatNode) || bytesSize != header->nbNodes ||
+        labelsSize != header->labelsSize || !checkSnapshot(header, nodes, bytes, labels)){
+        free(radix);
+        snapshotClose(snapshot);
+        return NULL;
+    }
+
+    // the arrays are only read until detach builds the nodes in memory
+    radix->root = NULL;
+    radix->size = header->size;
+    radix->maxKeyLength = header->maxKeyLength;
+    radix->flatNodes = nodes;
+    radix->flatFirstBytes = bytes;
+    radix->flatLabels = labels;
+    radix->nbFlatNodes = header->nbNodes;
+    radix->labelsSize = header->labelsSize;
+    radix->snapshot = snapshot;
+    return radix;
+}//end setOpen
+
+/* ----------------- RADIX CURSOR --------------------- */
+
+struct SetCursor_t
+{
+    const Set *set;
+    const RNode *node;    // last node entered, if the set is in memory
+    const FlatNode *flat; // last node entered, if the set is mapped
+    const char *label;    // label of that node
+    size_t labelLength;
+    size_t offset;        // number of characters of label already read
+    bool dead;
+};
+
+SetCursor *setCursorCreate(const Set *set){
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}//end setCursorCreate
+
+void setCursorFree(SetCursor *cursor){
+    free(cursor);
+}//end setCursorFree
+
+void setCursorReset(SetCursor *cursor){
+    const Set *set = cursor->set;
+    cursor->offset = 0;
+    cursor->labelLength = 0; // the label of the root is empty
+    cursor->label = NULL;
+    cursor->node = set->root;
+    cursor->flat = set->snapshot ? set->flatNodes : NULL;
+    cursor->dead = (cursor->node == NULL && cursor->flat == NULL);
+}//end setCursorReset
+
+int setCursorStep(SetCursor *cursor, char c){
+    if (cursor->dead)
+        return 0;
+
+    const Set *set = cursor->set;
+    if (cursor->offset == cursor->labelLength){ // on a node: enter the child starting with c
+        int i = -1;
+        if (c != '\0' && set->snapshot)
+            i = findChild(set->flatFirstBytes + cursor->flat->firstChild, cursor->flat->nbChildren, c);
+        else if (c != '\0')
+            i = findChild(firstBytes(cursor->node), cursor->node->nbChildren, c);
+        if (i < 0){
+            cursor->dead = true;
+            return 0;
         }
 
-        if (e == NULL){
-            free(pref);
-            free(tmp);
-            return prefixList;
+        if (set->snapshot){
+            cursor->flat = set->flatNodes + cursor->flat->firstChild + i;
+            cursor->label = set->flatLabels + cursor->flat->label;
+            cursor->labelLength = cursor->flat->labelLength;
+        }
+        else {
+            cursor->node = cursor->node->children[i];
+            cursor->label = cursor->node->label;
+            cursor->labelLength = cursor->node->labelLength;
         }
+        cursor->offset = 1;
     }
-    free(pref);
-    free(tmp);
-    return prefixList;
-}//end setGetAllStringPrefixes
+    else { // in the middle of a label
+        if (cursor->label[cursor->offset] != c){
+            cursor->dead = true;
+            return 0;
+        }
+        cursor->offset++;
+    }
+
+    if (cursor->offset != cursor->labelLength) // still in the middle of the label
+        return SET_CURSOR_PREFIX;
+
+    bool terminal = set->snapshot ? cursor->flat->terminal : cursor->node->terminal;
+    bool leaf = set->snapshot ? cursor->flat->nbChildren == 0 : isLeaf(cursor->node);
+
+    int flags = 0;
+    if (terminal)
+        flags |= SET_CURSOR_KEY;
+    if (!leaf)
+        flags |= SET_CURSOR_PREFIX;
+    return flags;
+}//end setCursorStep
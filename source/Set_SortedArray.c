@@ -0,0 +1,825 @@
+/* ========================================================================= *
+ * SortedArray
+ *
+ * Implementation of Set.h based on a sorted array of keys, for lexicons that
+ * are read far more often than they are modified. All the keys are stored
+ * one after the other in a single string pool, and the set only adds an
+ * array of 32-bit offsets into that pool (and a copy of the first bytes of
+ * each key), so that it takes little more than twice the memory of the
+ * lexicon itself.
+ *
+ * The offsets are kept in Eytzinger order: the sorted array laid out as a
+ * complete binary tree stored level by level, the children of index k being
+ * 2k and 2k + 1. A binary search then always moves forward in the array, the
+ * first levels share a few cache lines, and the next levels can be fetched
+ * ahead while the current key is compared. Each offset comes with the first
+ * four bytes of its key, so that most comparisons are decided without
+ * reading the pool.
+ *
+ * Insertions go to a small sorted array (the delta), merged into the main
+ * one when it grows too large. Searches look into both.
+ *
+ * ========================================================================= */
+
+#include "Set.h"
+#include "Snapshot.h"
+#include "SortedKeys.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INIT_POOL_SIZE 256
+#define DELTA_MIN 64 // the delta is merged when it holds at least that many keys
+                     // and the square of its size reaches the size of the main array
+
+/* Structures */
+
+typedef struct Entry_t
+{
+    uint32_t head;   // first 4 bytes of the key, big-endian, padded with 0
+    uint32_t offset; // offset of the key in the pool
+} Entry;
+
+struct Set_t
+{
+    char *pool;         // all keys, each followed by a \0
+    size_t poolSize;
+    size_t poolCapacity;
+    Entry *index;       // the main keys in Eytzinger order, in index[1..nbMain]
+    size_t nbMain;
+    uint32_t *delta;    // offsets of the keys inserted since the last merge, sorted
+    size_t nbDelta;
+    size_t deltaCapacity;
+    size_t maxKeyLength;
+    Snapshot *snapshot; // the file holding pool and index if they are mapped, NULL otherwise
+};
+
+/* Layout of the snapshot files */
+
+#define SECTION_HEADER 1
+#define SECTION_INDEX 2
+
+typedef struct SnapshotHeader_t
+{
+    uint64_t nbKeys;
+    uint64_t maxKeyLength;
+} SnapshotHeader;
+
+/* Prototypes */
+
+static int compareKey(const char *str, size_t length, const char *key);
+static uint32_t keyHead(const char *str, size_t length);
+static size_t leftTurns(size_t k);
+static size_t mainSearch(const Set *set, const char *str, size_t length, bool strict);
+static size_t deltaSearch(const Set *set, const char *str, size_t length, bool strict);
+static const char *lowerBound(const Set *set, const char *str, size_t length, bool strict);
+static size_t fillIndex(Entry *index, size_t n, const char *pool, const uint32_t *sorted, size_t i, size_t k);
+static size_t readIndex(const Entry *index, size_t n, uint32_t *sorted, size_t i, size_t k);
+static Entry *buildIndex(const Set *set);
+static bool checkSnapshot(const SnapshotHeader *header, const char *pool, size_t poolSize, const Entry *index);
+static bool merge(Set *set);
+static bool poolAppend(Set *set, const char *key, size_t length, uint32_t *offset);
+static bool detach(Set *set);
+static bool addPrefixToList(const char *key, size_t length, void *list);
+
+/* static functions */
+
+/**
+ * @brief Compare the first length characters of a string with a key
+ *
+ * @param str      A string of at least length characters
+ * @param length   The number of characters of str to compare
+ * @param key      A key
+ * @return int     < 0, 0 or > 0 as str[0..length[ is less than, equal to or
+ *                 greater than key
+ */
+static int compareKey(const char *str, size_t length, const char *key)
+{
+    int cmp = strncmp(str, key, length);
+    if (cmp == 0 && key[length] != '\0')
+        return -1; // str[0..length[ is a proper prefix of key
+    return cmp;
+}
+
+/**
+ * @brief Return the first 4 characters of a string as a big-endian integer,
+ *        padded with 0. Heads compare as the strings they start: when they
+ *        differ, so do the strings, in the same order.
+ *
+ * @param str      A string, read up to its \0 or its first length characters
+ * @param length   The maximal length of the string
+ * @return uint32_t
+ */
+static uint32_t keyHead(const char *str, size_t length)
+{
+    uint32_t head = 0;
+    size_t i = 0;
+    for (; i < 4 && i < length && str[i] != '\0'; i++)
+        head = head << 8 | (unsigned char)str[i];
+    for (; i < 4; i++)
+        head <<= 8;
+    return head;
+}
+
+/**
+ * @brief Return the number of times an Eytzinger search went left after it
+ *        last went right, plus one (the number of trailing 1 bits of k, plus
+ *        one).
+ *
+ * @param k        The index reached by the search, past the last level
+ * @return size_t
+ */
+static size_t leftTurns(size_t k)
+{
+#ifdef __GNUC__
+    return (size_t)__builtin_ctzll(~(unsigned long long)k) + 1;
+#else
+    size_t turns = 1;
+    for (; k & 1; k >>= 1)
+        turns++;
+    return turns;
+#endif
+}
+
+/**
+ * @brief Find the first main key greater than or equal to (or strictly greater
+ *        than) a string. The loop does not branch on the comparison, and the
+ *        offsets four levels below are prefetched.
+ *
+ * @param set      A pointer to a set
+ * @param str      A string of at least length characters
+ * @param length   The length of the string
+ * @param strict   true to skip a key equal to the string
+ * @return size_t  The Eytzinger index of the key, 0 if there is none
+ */
+static size_t mainSearch(const Set *set, const char *str, size_t length, bool strict)
+{
+    const Entry *index = set->index;
+    size_t n = set->nbMain;
+    size_t k = 1;
+    uint32_t head = keyHead(str, length);
+
+    while (k <= n)
+    {
+#ifdef __GNUC__
+        __builtin_prefetch(index + 16 * k);
+#endif
+        int cmp = (head > index[k].head) - (head < index[k].head);
+        if (cmp == 0)
+            cmp = compareKey(str, length, set->pool + index[k].offset);
+        k = 2 * k + (cmp > 0 || (strict && cmp == 0));
+    }
+    // the answer is the last node where the search went left
+    return k >> leftTurns(k);
+}
+
+/**
+ * @brief Find the first delta key greater than or equal to (or strictly
+ *        greater than) a string.
+ *
+ * @param set      A pointer to a set
+ * @param str      A string of at least length characters
+ * @param length   The length of the string
+ * @param strict   true to skip a key equal to the string
+ * @return size_t  The position of the key in the delta, nbDelta if there is none
+ */
+static size_t deltaSearch(const Set *set, const char *str, size_t length, bool strict)
+{
+    size_t low = 0;
+    size_t high = set->nbDelta;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        int cmp = compareKey(str, length, set->pool + set->delta[middle]);
+        if (cmp > 0 || (strict && cmp == 0))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/**
+ * @brief Find the first key of the set greater than or equal to (or strictly
+ *        greater than) a string.
+ *
+ * @param set      A pointer to a set
+ * @param str      A string of at least length characters
+ * @param length   The length of the string
+ * @param strict   true to skip a key equal to the string
+ * @return const char* The key, NULL if there is none
+ */
+static const char *lowerBound(const Set *set, const char *str, size_t length, bool strict)
+{
+    size_t k = mainSearch(set, str, length, strict);
+    const char *key = k ? set->pool + set->index[k].offset : NULL;
+
+    size_t d = deltaSearch(set, str, length, strict);
+    if (d < set->nbDelta)
+    {
+        const char *other = set->pool + set->delta[d];
+        if (!key || strcmp(other, key) < 0)
+            key = other;
+    }
+    return key;
+}
+
+/**
+ * @brief Store sorted offsets in Eytzinger order, by an in-order traversal of
+ *        the implicit tree.
+ *
+ * @param index    The array to fill, of n + 1 entries
+ * @param n        The number of offsets
+ * @param pool     The pool the offsets point into
+ * @param sorted   The sorted offsets
+ * @param i        The next sorted offset to store
+ * @param k        The node to fill
+ * @return size_t  The next sorted offset to store after the subtree of k
+ */
+static size_t fillIndex(Entry *index, size_t n, const char *pool, const uint32_t *sorted, size_t i, size_t k)
+{
+    if (k <= n)
+    {
+        i = fillIndex(index, n, pool, sorted, i, 2 * k);
+        const char *key = pool + sorted[i];
+        index[k].head = keyHead(key, 4);
+        index[k].offset = sorted[i++];
+        i = fillIndex(index, n, pool, sorted, i, 2 * k + 1);
+    }
+    return i;
+}
+
+/**
+ * @brief Read offsets stored in Eytzinger order back in sorted order (the
+ *        reverse of fillIndex).
+ *
+ * @param index    The entries in Eytzinger order
+ * @param n        The number of offsets
+ * @param sorted   The array to fill
+ * @param i        The next position of sorted
+ * @param k        The node to read
+ * @return size_t  The next position of sorted after the subtree of k
+ */
+static size_t readIndex(const Entry *index, size_t n, uint32_t *sorted, size_t i, size_t k)
+{
+    if (k <= n)
+    {
+        i = readIndex(index, n, sorted, i, 2 * k);
+        sorted[i++] = index[k].offset;
+        i = readIndex(index, n, sorted, i, 2 * k + 1);
+    }
+    return i;
+}
+
+/**
+ * @brief Build the Eytzinger index of all the keys, main and delta.
+ *
+ * @param set      A pointer to a set
+ * @return Entry*   The index, of nbMain + nbDelta + 1 entries, or NULL in case
+ *                   of allocation error. It needs to be freed by the user.
+ */
+static Entry *buildIndex(const Set *set)
+{
+    size_t n = set->nbMain + set->nbDelta;
+    uint32_t *main = malloc((set->nbMain ? set->nbMain : 1) * sizeof(uint32_t));
+    uint32_t *sorted = malloc((n ? n : 1) * sizeof(uint32_t));
+    Entry *index = malloc((n + 1) * sizeof(Entry));
+    if (!main || !sorted || !index)
+    {
+        free(main);
+        free(sorted);
+        free(index);
+        return NULL;
+    }
+
+    readIndex(set->index, set->nbMain, main, 0, 1);
+
+    size_t i = 0, d = 0, k = 0;
+    while (i < set->nbMain || d < set->nbDelta)
+    {
+        if (d == set->nbDelta ||
+            (i < set->nbMain && strcmp(set->pool + main[i], set->pool + set->delta[d]) < 0))
+            sorted[k++] = main[i++];
+        else
+            sorted[k++] = set->delta[d++];
+    }
+
+    index[0].head = index[0].offset = 0; // unused
+    fillIndex(index, n, set->pool, sorted, 0, 1);
+    free(main);
+    free(sorted);
+    return index;
+}
+
+/**
+ * @brief Merge the delta into the main array
+ *
+ * @param set      A pointer to a set that is not mapped
+ * @return bool    false in case of allocation error, the set being unchanged
+ */
+static bool merge(Set *set)
+{
+    Entry *index = buildIndex(set);
+    if (!index)
+        return false;
+
+    free(set->index);
+    set->index = index;
+    set->nbMain += set->nbDelta;
+    set->nbDelta = 0;
+    return true;
+}
+
+/**
+ * @brief Copy a key at the end of the pool
+ *
+ * @param set      A pointer to a set
+ * @param key      The key
+ * @param length   The length of the key
+ * @param offset   Set to the offset of the copy in the pool
+ * @return bool    false in case of allocation error, or if the pool would no
+ *                 longer be addressed by 32-bit offsets
+ */
+static bool poolAppend(Set *set, const char *key, size_t length, uint32_t *offset)
+{
+    if (set->poolSize + length + 1 > UINT32_MAX)
+        return false;
+
+    if (set->poolSize + length + 1 > set->poolCapacity)
+    {
+        size_t capacity = 2 * set->poolCapacity;
+        while (set->poolSize + length + 1 > capacity)
+            capacity *= 2;
+
+        char *pool = realloc(set->pool, capacity);
+        if (!pool)
+            return false;
+        set->pool = pool;
+        set->poolCapacity = capacity;
+    }
+
+    *offset = (uint32_t)set->poolSize;
+    memcpy(set->pool + set->poolSize, key, length + 1);
+    set->poolSize += length + 1;
+    return true;
+}
+
+/**
+ * @brief Copy in memory the pool and the index of a set opened from a
+ *        snapshot, so that it can be modified
+ *
+ * @param set      A pointer to a set
+ * @return bool    false in case of allocation error
+ */
+static bool detach(Set *set)
+{
+    if (!set->snapshot)
+        return true;
+
+    char *pool = malloc(set->poolCapacity);
+    Entry *index = malloc((set->nbMain + 1) * sizeof(Entry));
+    if (!pool || !index)
+    {
+        free(pool);
+        free(index);
+        return false;
+    }
+    memcpy(pool, set->pool, set->poolSize);
+    memcpy(index, set->index, (set->nbMain + 1) * sizeof(Entry));
+
+    set->pool = pool;
+    set->index = index;
+    snapshotClose(set->snapshot);
+    set->snapshot = NULL;
+    return true;
+}
+
+/**
+ * @brief SetVisitor appending a copy of each key to a list
+ *
+ * @param key      The key found
+ * @param length   The length of key
+ * @param list     A pointer to a List
+ * @return bool    false in case of allocation error
+ */
+static bool addPrefixToList(const char *key, size_t length, void *list)
+{
+    char *copy = malloc(length + 1);
+    if (!copy)
+        return false;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+
+    if (!listInsertLast(list, copy))
+    {
+        free(copy);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Check that the mapped sections of a snapshot describe a valid set:
+ *        the pool ends with a \0 and holds nbKeys keys, the longest being
+ *        maxKeyLength long; each entry of the index points to the start of a
+ *        key with the right head; read in order, the keys of the index are
+ *        strictly increasing, so each key of the pool is in it once.
+ *
+ * @param header   The header of the snapshot
+ * @param pool     The keys section
+ * @param poolSize The size of the keys section in bytes
+ * @param index    The index section, of header->nbKeys + 1 entries
+ * @return bool    true if the sections can be used as they are, false if not
+ *                 or in case of allocation error
+ */
+static bool checkSnapshot(const SnapshotHeader *header, const char *pool, size_t poolSize, const Entry *index)
+{
+    if (poolSize > UINT32_MAX || (poolSize > 0 && pool[poolSize - 1] != '\0'))
+        return false;
+
+    uint64_t nbKeys = 0;
+    size_t maxKeyLength = 0;
+    for (size_t offset = 0; offset < poolSize; nbKeys++)
+    {
+        size_t length = strlen(pool + offset);
+        if (length > maxKeyLength)
+            maxKeyLength = length;
+        offset += length + 1;
+    }
+    if (nbKeys != header->nbKeys || maxKeyLength != header->maxKeyLength)
+        return false;
+
+    size_t n = header->nbKeys;
+    uint32_t *sorted = malloc((n ? n : 1) * sizeof(uint32_t));
+    if (!sorted)
+        return false;
+    readIndex(index, n, sorted, 0, 1);
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < n; i++)
+    {
+        uint32_t offset = sorted[i];
+        ok = offset < poolSize && (offset == 0 || pool[offset - 1] == '\0') &&
+             (i == 0 || strcmp(pool + sorted[i - 1], pool + offset) < 0);
+    }
+    // the heads are read in Eytzinger order, once the offsets are known to be valid
+    for (size_t k = 1; ok && k <= n; k++)
+        ok = index[k].head == keyHead(pool + index[k].offset, 4);
+
+    free(sorted);
+    return ok;
+}
+
+/* header functions */
+
+Set *setCreateEmpty(void)
+{
+    Set *set = malloc(sizeof(Set));
+    if (!set)
+        return NULL;
+
+    set->poolSize = 0;
+    set->poolCapacity = INIT_POOL_SIZE;
+    set->nbMain = 0;
+    set->delta = NULL;
+    set->nbDelta = 0;
+    set->deltaCapacity = 0;
+    set->maxKeyLength = 0;
+    set->snapshot = NULL;
+
+    set->pool = malloc(set->poolCapacity);
+    set->index = calloc(1, sizeof(Entry));
+    if (!set->pool || !set->index)
+    {
+        free(set->pool);
+        free(set->index);
+        free(set);
+        return NULL;
+    }
+
+    return set;
+}
+
+void setFree(Set *set)
+{
+    if (!set)
+        return;
+
+    if (set->snapshot)
+        snapshotClose(set->snapshot);
+    else
+    {
+        free(set->pool);
+        free(set->index);
+    }
+    free(set->delta);
+    free(set);
+}
+
+size_t setNbKeys(const Set *set)
+{
+    if (!set)
+        return (size_t)-1;
+    return set->nbMain + set->nbDelta;
+}
+
+size_t setMemoryUsage(const Set *set)
+{
+    if (!set)
+        return 0;
+    return sizeof(Set) + set->poolCapacity + (set->nbMain + 1) * sizeof(Entry) +
+           set->deltaCapacity * sizeof(uint32_t);
+}
+
+bool setContains(const Set *set, const char *key)
+{
+    if (!set)
+        return false;
+
+    size_t length = strlen(key);
+    const char *found = lowerBound(set, key, length, false);
+    return found && strcmp(found, key) == 0;
+}
+
+int setInsert(Set *set, const char *key)
+{
+    if (!set)
+        return -1;
+
+    if (setContains(set, key))
+        return 0;
+    if (!detach(set))
+        return -1;
+
+    if (set->nbDelta == set->deltaCapacity)
+    {
+        size_t capacity = set->deltaCapacity ? 2 * set->deltaCapacity : DELTA_MIN;
+        uint32_t *delta = realloc(set->delta, capacity * sizeof(uint32_t));
+        if (!delta)
+            return -1;
+        set->delta = delta;
+        set->deltaCapacity = capacity;
+    }
+
+    size_t length = strlen(key);
+    uint32_t offset;
+    if (!poolAppend(set, key, length, &offset))
+        return -1;
+
+    size_t position = deltaSearch(set, key, length, false);
+    memmove(set->delta + position + 1, set->delta + position,
+            (set->nbDelta - position) * sizeof(uint32_t));
+    set->delta[position] = offset;
+    set->nbDelta++;
+
+    if (length > set->maxKeyLength)
+        set->maxKeyLength = length;
+
+    // if the merge fails, the key stays in the delta until the next one
+    if (set->nbDelta >= DELTA_MIN && set->nbDelta * set->nbDelta >= set->nbMain)
+        merge(set);
+    return 1;
+}
+
+Set *setBuildFromSorted(const char *const *keys, size_t nbKeys)
+{
+    size_t nbSorted;
+    const char **sorted = sortedKeys(keys, nbKeys, &nbSorted);
+    if (!sorted)
+        return NULL;
+
+    Set *set = setCreateEmpty();
+    uint32_t *offsets = malloc((nbSorted ? nbSorted : 1) * sizeof(uint32_t));
+    Entry *index = malloc((nbSorted + 1) * sizeof(Entry));
+    bool ok = set && offsets && index;
+
+    // the pool is allocated at its final size
+    size_t poolSize = 1;
+    for (size_t i = 0; i < nbSorted; i++)
+        poolSize += strlen(sorted[i]) + 1;
+    if (ok && poolSize > set->poolCapacity)
+    {
+        char *pool = realloc(set->pool, poolSize);
+        ok = pool != NULL;
+        if (ok)
+        {
+            set->pool = pool;
+            set->poolCapacity = poolSize;
+        }
+    }
+
+    // the keys are appended in order: the pool itself is sorted
+    for (size_t i = 0; ok && i < nbSorted; i++)
+    {
+        size_t length = strlen(sorted[i]);
+        ok = poolAppend(set, sorted[i], length, &offsets[i]);
+        if (length > set->maxKeyLength)
+            set->maxKeyLength = length;
+    }
+
+    if (ok)
+    {
+        index[0].head = index[0].offset = 0; // unused
+        fillIndex(index, nbSorted, set->pool, offsets, 0, 1);
+        free(set->index);
+        set->index = index;
+        set->nbMain = nbSorted;
+    }
+    else
+    {
+        free(index);
+        setFree(set);
+        set = NULL;
+    }
+
+    free(offsets);
+    free(sorted);
+    return set;
+}
+
+List *setGetAllStringPrefixes(const Set *set, const char *str)
+{
+    List *foundPrefixes = listNew();
+    if (!foundPrefixes)
+        return NULL;
+
+    if (!setVisitAllStringPrefixes(set, str, addPrefixToList, foundPrefixes))
+    {
+        listFree(foundPrefixes, true);
+        return NULL;
+    }
+    return foundPrefixes;
+}
+
+bool setVisitAllStringPrefixes(const Set *set, const char *str, SetVisitor visit, void *context)
+{
+    // at most one search per length: the first key not smaller than the prefix
+    // is the prefix itself if it is a key, and starts with it if any key does.
+    // When that key goes on with the next character of str, it is also the
+    // first key not smaller than the longer prefix, and no search is needed.
+    const char *key = NULL;
+    for (size_t length = 1; str[length - 1] != '\0' && length <= set->maxKeyLength; length++)
+    {
+        if (!key || key[length - 1] != str[length - 1])
+            key = lowerBound(set, str, length, false);
+        if (!key || strncmp(key, str, length) != 0)
+            return true;
+
+        if (key[length] == '\0')
+        {
+            if (!visit(key, length, context))
+                return false;
+            key = NULL; // a longer prefix is after it
+        }
+    }
+    return true;
+}
+
+bool setVisitAllKeys(const Set *set, SetVisitor visit, void *context)
+{
+    // the pool holds every key, in insertion order
+    for (size_t offset = 0; offset < set->poolSize;)
+    {
+        size_t length = strlen(set->pool + offset);
+        if (!visit(set->pool + offset, length, context))
+            return false;
+        offset += length + 1;
+    }
+    return true;
+}
+
+/* Snapshot */
+
+bool setSave(const Set *set, const char *filename)
+{
+    // the delta is merged in the written index, not in the set itself
+    Entry *index = set->nbDelta ? buildIndex(set) : set->index;
+    if (!index)
+        return false;
+
+    SnapshotHeader header = {set->nbMain + set->nbDelta, set->maxKeyLength};
+    SnapshotSection sections[] = {
+        {set->pool, set->poolSize}, // the pool holds exactly the keys
+        {&header, sizeof(SnapshotHeader)},
+        {index, (header.nbKeys + 1) * sizeof(Entry)},
+    };
+    bool ok = snapshotWrite(filename, "SortedArray", sections, 3);
+
+    if (index != set->index)
+        free(index);
+    return ok;
+}
+
+Set *setOpen(const char *filename)
+{
+    Snapshot *snapshot = snapshotOpen(filename, "SortedArray");
+    if (!snapshot)
+        return NULL;
+
+    size_t poolSize, headerSize, indexSize;
+    const char *pool = snapshotSection(snapshot, SNAPSHOT_KEYS, &poolSize);
+    const SnapshotHeader *header = snapshotSection(snapshot, SECTION_HEADER, &headerSize);
+    const Entry *index = snapshotSection(snapshot, SECTION_INDEX, &indexSize);
+
+    // every key takes at least its \0 in the pool: checking the number of keys
+    // against its size first keeps the size of the index from overflowing
+    Set *set = malloc(sizeof(Set));
+    if (!set || !pool || !header || !index || headerSize != sizeof(SnapshotHeader) ||
+        header->nbKeys > poolSize || indexSize != (header->nbKeys + 1) * sizeof(Entry) ||
+        !checkSnapshot(header, pool, poolSize, index))
+    {
+        free(set);
+        snapshotClose(snapshot);
+        return NULL;
+    }
+
+    // both are only read until detach copies them
+    set->pool = (char *)pool;
+    set->poolSize = poolSize;
+    set->poolCapacity = poolSize > 0 ? poolSize : 1;
+    set->index = (Entry *)index;
+    set->nbMain = header->nbKeys;
+    set->delta = NULL;
+    set->nbDelta = 0;
+    set->deltaCapacity = 0;
+    set->maxKeyLength = header->maxKeyLength;
+    set->snapshot = snapshot;
+    return set;
+}
+
+/* Cursor */
+
+struct SetCursor_t
+{
+    const Set *set;
+    char *buffer; // string read so far, of at most maxKeyLength characters
+    size_t length;
+    const char *key; // first key not smaller than buffer if it starts with it, or NULL
+    bool dead;
+};
+
+SetCursor *setCursorCreate(const Set *set)
+{
+    SetCursor *cursor = malloc(sizeof(SetCursor));
+    if (!cursor)
+        return NULL;
+
+    cursor->buffer = malloc(set->maxKeyLength + 1);
+    if (!cursor->buffer)
+    {
+        free(cursor);
+        return NULL;
+    }
+
+    cursor->set = set;
+    setCursorReset(cursor);
+    return cursor;
+}
+
+void setCursorFree(SetCursor *cursor)
+{
+    if (!cursor)
+        return;
+    free(cursor->buffer);
+    free(cursor);
+}
+
+void setCursorReset(SetCursor *cursor)
+{
+    cursor->length = 0;
+    cursor->key = NULL;
+    cursor->dead = false;
+}
+
+int setCursorStep(SetCursor *cursor, char c)
+{
+    if (cursor->dead || cursor->length == cursor->set->maxKeyLength)
+    {
+        cursor->dead = true;
+        return 0;
+    }
+
+    cursor->buffer[cursor->length++] = c;
+    const char *str = cursor->buffer;
+    size_t length = cursor->length;
+
+    // as in setVisitAllStringPrefixes, the previous key is kept when it goes on with c
+    const char *key = cursor->key;
+    if (!key || key[length - 1] != c)
+        key = lowerBound(cursor->set, str, length, false);
+    if (!key || strncmp(key, str, length) != 0)
+    {
+        cursor->dead = true;
+        return 0;
+    }
+    if (key[length] != '\0')
+    {
+        cursor->key = key;
+        return SET_CURSOR_PREFIX;
+    }
+
+    // the string read is a key: a longer key would be the next one
+    key = lowerBound(cursor->set, str, length, true);
+    cursor->key = key && strncmp(key, str, length) == 0 ? key : NULL;
+    return cursor->key ? SET_CURSOR_KEY | SET_CURSOR_PREFIX : SET_CURSOR_KEY;
+}
@@ -0,0 +1,275 @@
+/* ========================================================================= *
+ * Snapshot
+ *
+ * Writing and mapping of the snapshot files described in Snapshot.h.
+ * ========================================================================= */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "Snapshot.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "LEXSNAP1"
+#define BYTE_ORDER_MARK 0x01020304u
+#define BACKEND_NAME_SIZE 16
+
+/* Structures */
+
+typedef struct Header_t
+{
+    char magic[8];
+    char backend[BACKEND_NAME_SIZE];
+    uint32_t byteOrder; // BYTE_ORDER_MARK, as written by the machine
+    uint32_t wordSize;  // sizeof(size_t) on the machine
+    uint64_t nbSections;
+    uint64_t offsets[SNAPSHOT_MAX_SECTIONS];
+    uint64_t sizes[SNAPSHOT_MAX_SECTIONS];
+} Header;
+
+struct Snapshot_t
+{
+    void *address;
+    size_t length;
+    const Header *header;
+};
+
+/* Prototypes */
+
+static bool headerIsValid(const Header *header, size_t length);
+static size_t alignUp(size_t size);
+static bool writePadding(FILE *fp, size_t size);
+
+/* static functions */
+
+/**
+ * @brief Check the header of a file of a given length
+ *
+ * @param header   The start of the file
+ * @param length   The length of the file
+ * @return bool    true if the header is valid and all sections are aligned
+ *                 and in the file
+ */
+static bool headerIsValid(const Header *header, size_t length)
+{
+    if (length < sizeof(Header) || memcmp(header->magic, SNAPSHOT_MAGIC, 8) != 0 ||
+        header->byteOrder != BYTE_ORDER_MARK || header->wordSize != sizeof(size_t) ||
+        header->nbSections < 1 || header->nbSections > SNAPSHOT_MAX_SECTIONS)
+        return false;
+
+    for (uint64_t i = 0; i < header->nbSections; i++)
+    {
+        // the backends read their sections as arrays of structures
+        if (header->offsets[i] % SNAPSHOT_ALIGNMENT != 0 || header->offsets[i] > length ||
+            header->sizes[i] > length - header->offsets[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Round a size up to a multiple of SNAPSHOT_ALIGNMENT
+ *
+ * @param size     A size
+ * @return size_t  The rounded size
+ */
+static size_t alignUp(size_t size)
+{
+    return (size + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+/**
+ * @brief Write zero bytes
+ *
+ * @param fp       A file
+ * @param size     The number of bytes, less than SNAPSHOT_ALIGNMENT
+ * @return bool    false in case of error
+ */
+static bool writePadding(FILE *fp, size_t size)
+{
+    static const char zeros[SNAPSHOT_ALIGNMENT];
+    return fwrite(zeros, 1, size, fp) == size;
+}
+
+/* header functions */
+
+bool snapshotIsSnapshot(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return false;
+
+    char magic[8];
+    bool result = fread(magic, 1, 8, fp) == 8 && memcmp(magic, SNAPSHOT_MAGIC, 8) == 0;
+    fclose(fp);
+    return result;
+}
+
+bool snapshotWrite(const char *filename, const char *backend,
+                   const SnapshotSection *sections, size_t nbSections)
+{
+    if (nbSections < 1 || nbSections > SNAPSHOT_MAX_SECTIONS || strlen(backend) >= BACKEND_NAME_SIZE)
+        return false;
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+    strcpy(header.backend, backend);
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.wordSize = sizeof(size_t);
+    header.nbSections = nbSections;
+
+    size_t offset = alignUp(sizeof(Header));
+    for (size_t i = 0; i < nbSections; i++)
+    {
+        header.offsets[i] = offset;
+        header.sizes[i] = sections[i].size;
+        offset = alignUp(offset + sections[i].size);
+    }
+
+    FILE *fp = fopen(filename, "wb");
+    if (!fp)
+        return false;
+
+    bool ok = fwrite(&header, sizeof(Header), 1, fp) == 1 &&
+              writePadding(fp, alignUp(sizeof(Header)) - sizeof(Header));
+    for (size_t i = 0; ok && i < nbSections; i++)
+    {
+        ok = (sections[i].size == 0 || fwrite(sections[i].data, 1, sections[i].size, fp) == sections[i].size) &&
+             writePadding(fp, alignUp(sections[i].size) - sections[i].size);
+    }
+
+    if (fclose(fp) != 0)
+        ok = false;
+    if (!ok)
+        remove(filename);
+    return ok;
+}
+
+bool snapshotKeysAppend(SnapshotKeys *keys, const char *key, size_t length)
+{
+    if (keys->size + length + 1 > keys->capacity)
+    {
+        size_t capacity = keys->capacity ? 2 * keys->capacity : 4096;
+        while (keys->size + length + 1 > capacity)
+            capacity *= 2;
+
+        char *data = realloc(keys->data, capacity);
+        if (!data)
+            return false;
+        keys->data = data;
+        keys->capacity = capacity;
+    }
+
+    memcpy(keys->data + keys->size, key, length);
+    keys->data[keys->size + length] = '\0';
+    keys->size += length + 1;
+    return true;
+}
+
+bool snapshotKeysAdd(const char *key, size_t length, void *keys)
+{
+    return snapshotKeysAppend(keys, key, length);
+}
+
+Snapshot *snapshotOpen(const char *filename, const char *backend)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // the pages are shared by all the processes mapping the same file
+    size_t length = (size_t)info.st_size;
+    void *address = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return NULL;
+
+    const Header *header = address;
+    if (!headerIsValid(header, length) ||
+        (backend && strncmp(header->backend, backend, BACKEND_NAME_SIZE) != 0))
+    {
+        munmap(address, length);
+        return NULL;
+    }
+
+    Snapshot *snapshot = malloc(sizeof(Snapshot));
+    if (!snapshot)
+    {
+        munmap(address, length);
+        return NULL;
+    }
+    snapshot->address = address;
+    snapshot->length = length;
+    snapshot->header = header;
+    return snapshot;
+}
+
+void snapshotClose(Snapshot *snapshot)
+{
+    if (!snapshot)
+        return;
+
+    munmap(snapshot->address, snapshot->length);
+    free(snapshot);
+}
+
+size_t snapshotNbSections(const Snapshot *snapshot)
+{
+    return (size_t)snapshot->header->nbSections;
+}
+
+const void *snapshotSection(const Snapshot *snapshot, size_t index, size_t *size)
+{
+    if (index >= snapshot->header->nbSections)
+        return NULL;
+
+    if (size)
+        *size = (size_t)snapshot->header->sizes[index];
+    return (const char *)snapshot->address + snapshot->header->offsets[index];
+}
+
+const char **snapshotKeys(const Snapshot *snapshot, size_t *nbKeys)
+{
+    size_t size = 0;
+    const char *keys = snapshotSection(snapshot, SNAPSHOT_KEYS, &size);
+
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (keys[i] == '\0')
+            n++;
+    }
+
+    const char **array = malloc((n ? n : 1) * sizeof(const char *));
+    if (!array)
+        return NULL;
+
+    size_t i = 0;
+    for (size_t k = 0; k < n; k++)
+    {
+        array[k] = keys + i;
+        i += strlen(keys + i) + 1;
+    }
+
+    *nbKeys = n;
+    return array;
+}
+
+size_t snapshotSize(const Snapshot *snapshot)
+{
+    return snapshot->length;
+}
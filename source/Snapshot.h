@@ -0,0 +1,139 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A snapshot is a file holding a set as a few raw sections, each aligned on
+ * SNAPSHOT_ALIGNMENT bytes, so that it can be used directly from a read-only
+ * mapping. Section SNAPSHOT_KEYS always holds all the keys of the set, each
+ * followed by a \0; the other sections belong to the backend that wrote the
+ * file. Sections are written in the native layout of the machine: a snapshot
+ * can only be opened on a machine with the same byte order and word size.
+ */
+
+/** Snapshot (opaque) structure, an open and mapped snapshot file */
+typedef struct Snapshot_t Snapshot;
+
+/** A section to write */
+typedef struct SnapshotSection_t
+{
+    const void *data;
+    size_t size;
+} SnapshotSection;
+
+/** Keys gathered for the SNAPSHOT_KEYS section, to be initialised with {NULL, 0, 0} */
+typedef struct SnapshotKeys_t
+{
+    char *data; // the keys, each followed by a \0
+    size_t size;
+    size_t capacity;
+} SnapshotKeys;
+
+#define SNAPSHOT_KEYS 0          // index of the section holding the keys
+#define SNAPSHOT_MAX_SECTIONS 8
+#define SNAPSHOT_ALIGNMENT 64
+
+/**
+ * @brief Return true if the file starts like a snapshot, false otherwise
+ *        (including when it cannot be read).
+ *
+ * @param filename     The name of a file
+ * @return bool
+ */
+bool snapshotIsSnapshot(const char *filename);
+
+/**
+ * @brief Write a snapshot file.
+ *
+ * @param filename     The name of the file to create
+ * @param backend      The name of the backend writing the file (at most 15 characters)
+ * @param sections     The sections to write, the first one holding the keys
+ * @param nbSections   The number of sections, between 1 and SNAPSHOT_MAX_SECTIONS
+ * @return bool        false in case of error
+ */
+bool snapshotWrite(const char *filename, const char *backend,
+                   const SnapshotSection *sections, size_t nbSections);
+
+/**
+ * @brief Append a key to the keys of a snapshot. keys->data needs to be freed
+ *        by the user.
+ *
+ * @param keys         A pointer to the keys gathered so far
+ * @param key          The key, not necessarily followed by a \0
+ * @param length       The length of the key
+ * @return bool        false in case of allocation error
+ */
+bool snapshotKeysAppend(SnapshotKeys *keys, const char *key, size_t length);
+
+/**
+ * @brief Same as snapshotKeysAppend, with the arguments of a SetVisitor (see
+ *        Set.h), so that setVisitAllKeys can gather the keys of a set.
+ *
+ * @param key          The key, not necessarily followed by a \0
+ * @param length       The length of the key
+ * @param keys         A pointer to the SnapshotKeys gathered so far
+ * @return bool        false in case of allocation error
+ */
+bool snapshotKeysAdd(const char *key, size_t length, void *keys);
+
+/**
+ * @brief Map a snapshot file in memory. The returned snapshot needs to be
+ *        closed with snapshotClose, which invalidates all its sections.
+ *
+ * @param filename     The name of a snapshot file
+ * @param backend      The backend that must have written the file, or NULL
+ *                     to accept any of them
+ * @return Snapshot*   The snapshot, or NULL if the file cannot be mapped or
+ *                     is not a snapshot written by backend
+ */
+Snapshot *snapshotOpen(const char *filename, const char *backend);
+
+/**
+ * @brief Unmap a snapshot.
+ *
+ * @param snapshot     A pointer to a snapshot
+ */
+void snapshotClose(Snapshot *snapshot);
+
+/**
+ * @brief Return the number of sections of a snapshot.
+ *
+ * @param snapshot     A pointer to a snapshot
+ * @return size_t      The number of sections
+ */
+size_t snapshotNbSections(const Snapshot *snapshot);
+
+/**
+ * @brief Return a section of a snapshot, aligned on SNAPSHOT_ALIGNMENT bytes.
+ *
+ * @param snapshot     A pointer to a snapshot
+ * @param index        The index of the section
+ * @param size         If not NULL, set to the size of the section
+ * @return const void* The start of the section in the mapping, NULL if there
+ *                     is no such section
+ */
+const void *snapshotSection(const Snapshot *snapshot, size_t index, size_t *size);
+
+/**
+ * @brief Return the keys of a snapshot, in the order they were written. The
+ *        strings point into the mapping and are only valid until the snapshot
+ *        is closed; the returned array needs to be freed by the user.
+ *
+ * @param snapshot     A pointer to a snapshot
+ * @param nbKeys       Set to the number of keys
+ * @return const char** An array of nbKeys strings, or NULL in case of
+ *                      allocation error
+ */
+const char **snapshotKeys(const Snapshot *snapshot, size_t *nbKeys);
+
+/**
+ * @brief Return the total size of a mapped snapshot.
+ *
+ * @param snapshot     A pointer to a snapshot
+ * @return size_t      The number of bytes mapped
+ */
+size_t snapshotSize(const Snapshot *snapshot);
+
+#endif // !_SNAPSHOT_H_
@@ -0,0 +1,65 @@
+/* ========================================================================= *
+ * SortedKeys
+ *
+ * Sorting and deduplication of the keys given to setBuildFromSorted.
+ * ========================================================================= */
+
+#include "SortedKeys.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Prototypes */
+
+static int compareKeys(const void *a, const void *b);
+
+/* static functions */
+
+/**
+ * @brief Compare two keys for qsort
+ *
+ * @param a        A pointer to a string
+ * @param b        A pointer to a string
+ * @return int     As strcmp
+ */
+static int compareKeys(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* header functions */
+
+const char **sortedKeys(const char *const *keys, size_t nbKeys, size_t *nbSorted)
+{
+    const char **sorted = malloc((nbKeys ? nbKeys : 1) * sizeof(const char *));
+    if (!sorted)
+        return NULL;
+
+    bool isSorted = true;
+    for (size_t i = 0; i < nbKeys; i++)
+    {
+        sorted[i] = keys[i];
+        if (i > 0 && isSorted && strcmp(keys[i - 1], keys[i]) > 0)
+            isSorted = false;
+    }
+    if (!isSorted)
+        qsort(sorted, nbKeys, sizeof(const char *), compareKeys);
+
+    size_t n = 0;
+    for (size_t i = 0; i < nbKeys; i++)
+    {
+        if (n == 0 || strcmp(sorted[n - 1], sorted[i]) != 0)
+            sorted[n++] = sorted[i];
+    }
+
+    *nbSorted = n;
+    return sorted;
+}
+
+size_t sortedKeysCommonPrefix(const char *a, const char *b)
+{
+    size_t length = 0;
+    while (a[length] != '\0' && a[length] == b[length])
+        length++;
+    return length;
+}
@@ -0,0 +1,35 @@
+#ifndef _SORTEDKEYS_H_
+#define _SORTEDKEYS_H_
+
+#include <stddef.h>
+
+/*
+ * Helpers shared by the implementations of setBuildFromSorted: the keys are
+ * put in strcmp order (the order of their bytes as unsigned char) and each
+ * distinct key is kept once, so that a set can be built in a single pass.
+ */
+
+/**
+ * @brief Return the keys sorted in strcmp order, without duplicates. They are
+ *        only sorted if they are not already, so a sorted lexicon costs a
+ *        single pass. The strings are not copied. The returned array needs to
+ *        be freed by the user.
+ *
+ * @param keys         An array of valid strings
+ * @param nbKeys       The number of strings
+ * @param nbSorted     Set to the number of distinct strings
+ * @return const char** An array of nbSorted strings, or NULL in case of
+ *                      allocation error
+ */
+const char **sortedKeys(const char *const *keys, size_t nbKeys, size_t *nbSorted);
+
+/**
+ * @brief Return the length of the longest common prefix of two strings.
+ *
+ * @param a            A valid string
+ * @param b            A valid string
+ * @return size_t      The number of leading characters shared by a and b
+ */
+size_t sortedKeysCommonPrefix(const char *a, const char *b);
+
+#endif // !_SORTEDKEYS_H_
@@ -3,71 +3,27 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "AhoCorasick.h"
 #include "Board.h"
+#include "Lexicon.h"
 #include "List.h"
+#include "Parallel.h"
 #include "Set.h"
-
-#define BUFFER_SIZE 500
-
-static List *readLines(const char *filename);
-
-static List *readLines(const char *filename)
-{
-
-    FILE *fp = fopen(filename, "r");
-    if (!fp)
-    {
-        fprintf(stderr, "readLines: Error while opening '%s'.\n", filename);
-        exit(1);
-    }
-
-    List *lines = listNew();
-    if (!lines)
-    {
-        fprintf(stderr, "readLines: Error in 'listNew'.\n");
-        exit(1);
-    }
-
-    char buffer[BUFFER_SIZE];
-    while (fgets(buffer, BUFFER_SIZE, fp))
-    {
-        size_t length = strlen(buffer);
-
-        if (buffer[length - 1] == '\n')
-            buffer[--length] = '\0';
-
-        char *copy = malloc(length + 1);
-        if (!copy)
-        {
-            fprintf(stderr, "readLines: Error in 'malloc'.\n");
-            exit(1);
-        }
-        memcpy(copy, buffer, length + 1);
-        listInsertLast(lines, copy);
-    }
-    fclose(fp);
-
-    return lines;
-}
-
+#include "Snapshot.h"
 
 int main(int argc, char **argv)
 {
     // Check arguments
-    if (argc != 3)
+    if (argc != 3 && argc != 4)
     {
-        printf("Usage: %s <File> <board_size>\n", argv[0]);
+        printf("Usage: %s <File> <board_size> [<snapshot_to_write>]\n", argv[0]);
+        printf("<File> is a lexicon (one word per line) or a snapshot of the set.\n");
         return -1;
     }
 
     // grid size
     size_t size = atoi(argv[2]);
 
-    // Load the lexicon
-    List *words = readLines(argv[1]);
-
-    printf("%zu words have been read.\n", listSize(words));
-
     // ---------------------------
     // Search driven by the board
     // ---------------------------
@@ -75,18 +31,74 @@ int main(int argc, char **argv)
     // creation of the Set
     // ---------------------------
 
-    printf("Creation of the set...");
-    clock_t begin = clock();
-
-    Set *set = setCreateEmpty();
-    for (LNode *p = words->head; p != NULL; p = p->next)
+    Set *set;
+    clock_t begin, end;
+    if (snapshotIsSnapshot(argv[1]))
     {
-        if (setInsert(set, p->value) == 0)
-            printf("\nkey '%s' is duplicated in %s\n", (char *)p->value, argv[1]);
+        printf("Opening the snapshot...");
+        begin = clock();
+        set = setOpen(argv[1]);
+        end = clock();
+        if (!set)
+        {
+            fprintf(stderr, "\nError: '%s' is not a snapshot of this set.\n", argv[1]);
+            return -1;
+        }
+        printf("Finished in %ld ms\n", (end - begin) * 1000 / CLOCKS_PER_SEC);
+        printf("%zu words are in the set.\n", setNbKeys(set));
     }
+    else
+    {
+        // Load the lexicon
+        printf("Reading the lexicon...");
+        long start = parallelWallClockMillis();
+        Lexicon *lexicon = lexiconOpen(argv[1], 0);
+        if (!lexicon)
+        {
+            fprintf(stderr, "\nError while reading '%s'.\n", argv[1]);
+            return -1;
+        }
+        printf("Finished in %ld ms (real time)\n", parallelWallClockMillis() - start);
+        printf("%zu words have been read.\n", lexiconNbWords(lexicon));
 
-    clock_t end = clock();
-    printf("Finished in %ld ms\n", (end - begin) * 1000 / CLOCKS_PER_SEC);
+        printf("Creation of the set...");
+        begin = clock();
+
+        // the set is built in one pass from all the words rather than by
+        // successive insertions
+        size_t nbKeys = lexiconNbWords(lexicon);
+        const char **keys = malloc((nbKeys ? nbKeys : 1) * sizeof(const char *));
+        if (!keys)
+        {
+            fprintf(stderr, "\nError: allocation of the keys failed.\n");
+            return -1;
+        }
+        for (size_t i = 0; i < nbKeys; i++)
+            keys[i] = lexiconWord(lexicon, i);
+
+        set = setBuildFromSorted(keys, nbKeys);
+        free(keys);
+        if (!set)
+        {
+            fprintf(stderr, "\nError: creation of the set failed.\n");
+            return -1;
+        }
+
+        end = clock();
+        printf("Finished in %ld ms\n", (end - begin) * 1000 / CLOCKS_PER_SEC);
+        if (setNbKeys(set) != nbKeys)
+            printf("%zu duplicated keys in %s were ignored\n", nbKeys - setNbKeys(set), argv[1]);
+        lexiconClose(lexicon);
+    }
+    printf("%zu bytes used by the set\n", setMemoryUsage(set));
+
+    if (argc == 4)
+    {
+        if (setSave(set, argv[3]))
+            printf("Snapshot written to %s\n", argv[3]);
+        else
+            fprintf(stderr, "Error while writing the snapshot '%s'.\n", argv[3]);
+    }
 
     // create a random board
     // ---------------------
@@ -105,6 +117,45 @@ int main(int argc, char **argv)
     printf("%zu words found on the grid\n", listSize(result));
     printf("Finished in %ld ms\n", (end - begin) * 1000 / CLOCKS_PER_SEC);
 
+    // the same search, on all the processors
+    // ---------------------------------------
+    printf("Parallel search driven by the board...");
+    long wallBegin = parallelWallClockMillis();
+    List *parallel = boardGetAllWordsFromSetParallel(board, set, 0);
+    long wallEnd = parallelWallClockMillis();
+
+    printf("%zu words found on the grid\n", listSize(parallel));
+    printf("Finished in %ld ms (real time)\n", wallEnd - wallBegin);
+    if (listSize(parallel) != listSize(result))
+        printf("The two searches do not agree.\n");
+    listFree(parallel, true);
+
+    // search driven by the automaton of the set
+    // -----------------------------------------
+    printf("Creation of the automaton...");
+    begin = clock();
+    AhoCorasick *ac = acCreate(set);
+    end = clock();
+    if (!ac)
+    {
+        fprintf(stderr, "\nError: creation of the automaton failed.\n");
+        exit(1);
+    }
+    printf("Finished in %ld ms\n", (end - begin) * 1000 / CLOCKS_PER_SEC);
+    printf("%zu bytes used by the automaton\n", acMemoryUsage(ac));
+
+    printf("Search driven by the automaton...");
+    begin = clock();
+    List *scanned = boardGetAllWordsFromAutomaton(board, ac);
+    end = clock();
+
+    printf("%zu words found on the grid\n", listSize(scanned));
+    printf("Finished in %ld ms\n", (end - begin) * 1000 / CLOCKS_PER_SEC);
+    if (listSize(scanned) != listSize(result))
+        printf("The two searches do not agree.\n");
+    listFree(scanned, true);
+    acFree(ac);
+
     // display longest word found
     // --------------------------
     char *longestWord;
@@ -140,7 +191,6 @@ int main(int argc, char **argv)
 
 
     listFree(result, true);
-    listFree(words, true);
     boardFree(board);
     setFree(set);
 
@@ -1,73 +1,97 @@
+#include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "Board.h"
+#include "Lexicon.h"
 #include "List.h"
+#include "Parallel.h"
+#include "Snapshot.h"
 
-#define BUFFER_SIZE 500
+static const char **readLexicon(const char *filename, Lexicon **lexicon, size_t *nbWords);
+static const char **readSnapshot(const char *filename, Snapshot **snapshot, size_t *nbWords);
 
-static List *readLines(const char *filename);
-
-static List *readLines(const char *filename)
+static const char **readLexicon(const char *filename, Lexicon **lexicon, size_t *nbWords)
 {
-
-    FILE *fp = fopen(filename, "r");
-    if (!fp)
+    *lexicon = lexiconOpen(filename, 0);
+    if (!*lexicon)
     {
-        fprintf(stderr, "readLines: Error while opening '%s'.\n", filename);
+        fprintf(stderr, "readLexicon: Error while reading '%s'.\n", filename);
         exit(1);
     }
 
-    List *lines = listNew();
-    if (!lines)
+    // the words are used in place, from the mapped file
+    *nbWords = lexiconNbWords(*lexicon);
+    const char **words = malloc((*nbWords ? *nbWords : 1) * sizeof(const char *));
+    if (!words)
     {
-        fprintf(stderr, "readLines: Error in 'listNew'.\n");
+        fprintf(stderr, "readLexicon: Error in 'malloc'.\n");
         exit(1);
     }
+    for (size_t i = 0; i < *nbWords; i++)
+        words[i] = lexiconWord(*lexicon, i);
 
-    char buffer[BUFFER_SIZE];
-    while (fgets(buffer, BUFFER_SIZE, fp))
-    {
-        size_t length = strlen(buffer);
+    return words;
+}
 
-        if (buffer[length - 1] == '\n')
-            buffer[--length] = '\0';
+static const char **readSnapshot(const char *filename, Snapshot **snapshot, size_t *nbWords)
+{
+    *snapshot = snapshotOpen(filename, NULL);
+    if (!*snapshot)
+    {
+        fprintf(stderr, "readSnapshot: Error while opening '%s'.\n", filename);
+        exit(1);
+    }
 
-        char *copy = malloc(length + 1);
-        if (!copy)
-        {
-            fprintf(stderr, "readLines: Error in 'malloc'.\n");
-            exit(1);
-        }
-        memcpy(copy, buffer, length + 1);
-        listInsertLast(lines, copy);
+    // the words are used in place, from the mapped file
+    const char **words = snapshotKeys(*snapshot, nbWords);
+    if (!words)
+    {
+        fprintf(stderr, "readSnapshot: Error in 'snapshotKeys'.\n");
+        exit(1);
     }
-    fclose(fp);
 
-    return lines;
+    return words;
 }
 
 int main(int argc, char **argv)
 {
     // Check arguments
-    if (argc != 3)
+    if (argc != 3 && (argc != 4 || strcmp(argv[3], "bitboards") != 0))
     {
-        printf("Usage: %s <File> <size>\n", argv[0]);
+        printf("Usage: %s <File> <size> [bitboards]\n", argv[0]);
+        printf("bitboards searches the board with bitplanes instead of an index of its letters.\n");
         return -1;
     }
 
     // grid size
     size_t size = atoi(argv[2]);
 
-    // Load the lexicon
-    List *words = readLines(argv[1]);
+    // Load the lexicon, from a text file or from the keys of a snapshot, as
+    // an array for the threads of the search
+    Snapshot *snapshot = NULL;
+    Lexicon *lexicon = NULL;
+    size_t nbWords;
+    const char **array;
+    long start = parallelWallClockMillis();
+    if (snapshotIsSnapshot(argv[1]))
+        array = readSnapshot(argv[1], &snapshot, &nbWords);
+    else
+        array = readLexicon(argv[1], &lexicon, &nbWords);
 
-    printf("%zu words have been read.\n", listSize(words));
+    printf("%zu words have been read in %ld ms (real time).\n", nbWords, parallelWallClockMillis() - start);
 
-    if (!words)
-        return -1;
+    // the letters of the words, for the prefilter of the search
+    uint32_t *masks = malloc((nbWords ? nbWords : 1) * sizeof(uint32_t));
+    if (!masks)
+    {
+        fprintf(stderr, "Error in 'malloc'.\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < nbWords; i++)
+        masks[i] = boardLetterMask(array[i]);
 
     // ----------------------------------
     // Search driven by the lexicon:
@@ -79,40 +103,38 @@ int main(int argc, char **argv)
     // create a random board
     srand(42); // change into srand(time(NULL)) to get a random board
     Board *board = boardCreate(size, NULL);
+    if (argc == 4 && !boardUseBitboards(board))
+        printf("The bitplanes cannot be used, the board is searched with its index.\n");
+    if (argc == 3 && !boardBuildIndex(board))
+        printf("The index cannot be built, the board is scanned for each word.\n");
 
     boardDisplay(board);
 
     // search driven by the lexicon
     // ----------------------------
 
+    // all the processors share the board, the words found are in the order
+    // of the lexicon
     printf("Search driven by the lexicon...");
-    clock_t begin = clock();
-    List *result = listNew();
-
-    for (LNode *p = words->head; p != NULL; p = p->next)
+    long begin = parallelWallClockMillis();
+    size_t pruned;
+    List *result = boardGetAllWordsFromLexicon(board, array, masks, nbWords, 0, &pruned);
+    if (!result)
     {
-        if (boardContainsWord(board, p->value))
-        {
-            char *copy = malloc(strlen(p->value) + 1);
-            if (!copy)
-            {
-                fprintf(stderr, "Error in 'malloc'.\n");
-                exit(1);
-            }
-            memcpy(copy, p->value, strlen(p->value) + 1);
-            listInsertLast(result, copy);
-        }
+        fprintf(stderr, "Error in 'malloc'.\n");
+        exit(1);
     }
 
-    clock_t end = clock();
-    unsigned long millis = (end - begin) * 1000 / CLOCKS_PER_SEC;
+    long end = parallelWallClockMillis();
     printf("\n%zu words found on the board\n", listSize(result));
-    printf("Finished in %ld ms\n", millis);
+    printf("%zu words were pruned by the letter counts of the board\n", pruned);
+    printf("Finished in %ld ms (real time)\n", end - begin);
 
     // display longest word found
     // --------------------------
     char *longestWord;
     size_t maxLength = 0;
+    BoardMatch match;
     for (LNode *p = result->head; p != NULL; p = p->next)
     {
         size_t lengthWord = strlen(p->value);
@@ -127,9 +149,10 @@ int main(int argc, char **argv)
     {
         printf("No word was found.\n");
     }
-    else if (boardContainsWord(board, longestWord))
+    else if (boardFindWord(board, longestWord, &match))
     {
         printf("Longest word found: %s\n", longestWord);
+        boardHighlightMatch(board, &match);
         boardDisplay(board);
     }
     else
@@ -143,8 +166,11 @@ int main(int argc, char **argv)
     printf("\n");
     */
 
+    free(array);
+    free(masks);
     listFree(result, true);
-    listFree(words, true);
+    lexiconClose(lexicon);
+    snapshotClose(snapshot);
     boardFree(board);
 
     return 0;
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Parallel.h"
+#include "Set.h"
+
+/*
+ * Checks the insertion of the same keys by several threads at once into a
+ * concurrent set: each key must be reported as inserted (1) by exactly one
+ * thread and as already there (0) by all the others. The set starts empty, so
+ * that the threads also race with the growth of the table.
+ */
+
+#define NB_KEYS 20000
+#define NB_INSERTERS 8
+#define NB_ROUNDS 10
+#define KEY_SIZE 16
+
+typedef struct Inserter_t
+{
+    Set *set;
+    char (*keys)[KEY_SIZE];
+    size_t first; // the keys are inserted from keys[first], in a different order for each thread
+    int results[NB_KEYS]; // result of setInsert for each key
+} Inserter;
+
+static void *insertAll(void *context);
+
+static void *insertAll(void *context)
+{
+    Inserter *inserter = context;
+    for (size_t i = 0; i < NB_KEYS; i++)
+    {
+        size_t k = (inserter->first + i * 7919) % NB_KEYS;
+        inserter->results[k] = setInsert(inserter->set, inserter->keys[k]);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    static char keys[NB_KEYS][KEY_SIZE];
+    for (size_t k = 0; k < NB_KEYS; k++)
+        snprintf(keys[k], KEY_SIZE, "key%zu", k);
+
+    Inserter *inserters = malloc(NB_INSERTERS * sizeof(Inserter));
+    if (!inserters)
+    {
+        fprintf(stderr, "Error in 'malloc'.\n");
+        return 1;
+    }
+
+    size_t errors = 0;
+    for (size_t round = 0; round < NB_ROUNDS; round++)
+    {
+        Set *set = setCreateEmpty();
+        if (!set)
+        {
+            fprintf(stderr, "Error in 'setCreateEmpty'.\n");
+            return 1;
+        }
+        for (size_t t = 0; t < NB_INSERTERS; t++)
+        {
+            inserters[t].set = set;
+            inserters[t].keys = keys;
+            inserters[t].first = t * NB_KEYS / NB_INSERTERS;
+        }
+        parallelRun(insertAll, inserters, sizeof(Inserter), NB_INSERTERS);
+
+        for (size_t k = 0; k < NB_KEYS; k++)
+        {
+            size_t inserted = 0, present = 0;
+            for (size_t t = 0; t < NB_INSERTERS; t++)
+            {
+                inserted += inserters[t].results[k] == 1;
+                present += inserters[t].results[k] == 0;
+            }
+            if (inserted != 1 || present != NB_INSERTERS - 1 || !setContains(set, keys[k]))
+            {
+                printf("'%s': inserted by %zu threads, already there for %zu\n", keys[k], inserted, present);
+                errors++;
+            }
+        }
+        if (setNbKeys(set) != NB_KEYS)
+        {
+            printf("%zu keys in the set instead of %d\n", setNbKeys(set), NB_KEYS);
+            errors++;
+        }
+        setFree(set);
+    }
+
+    free(inserters);
+    printf("%d rounds of %d threads inserting %d keys: %zu errors\n", NB_ROUNDS, NB_INSERTERS, NB_KEYS, errors);
+    return errors == 0 ? 0 : 1;
+}